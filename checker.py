@@ -3,13 +3,12 @@
 import sys
 import os
 import re
-import numpy as np
-from pysmps import smps_loader as smps
+import subprocess
+import tempfile
 
 
 # Usage: ./checker.py sequential-cpp/openmp-cpp 0/1
 
-# load pysymps
 '''
 TODO: Import all of netlib/lp/data to inputs
 Use the decompression there to get regular MPS files
@@ -27,155 +26,142 @@ print overall time taken at end
 '''
 
 
-def writeArrays(outputFile, A, b, c):
-    with open(outputFile, 'w') as outFile:
-        outFile.write('%d %d\n' % (len(A), len(c))) #m, n
-        for rule in A:
-            outStr = []
-            for num in rule: 
-                outStr.append("%f " % num)
-            outFile.write(''.join(outStr) + '\n')
-        
-        outStr = []
-        for rule in b:
-            outStr.append("%f " % rule)
-        outFile.write(''.join(outStr) + '\n')
-
-        outStr = []
-        for rule in c:
-            outStr.append("%f " % rule)
-        outFile.write(''.join(outStr) + '\n')
-
-
-def parseInput(test_locations, test_name):
-        test_location = test_locations + test_name
-        res = smps.load_mps(test_location)
-        # print(res)
-
-        # LP format is AX (relation) b, and minimize cX
-
-        relation = res[5] # L, G, E (<=, >=, ==)
-        c = res[6]
-        A = res[7]
-        rhs_names = res[8]
-        assert(len(rhs_names) == 1) # Multiple right hand sides isn't supported
-        b = res[9]
-
-        print(A)
-        print(b[rhs_names[0]])
-        print(c)
-
-        rhsB = b[rhs_names[0]]
-        newA = []
-        newB = []
-        newC = c
-
-        # Convert to standard form
-        for i in range(len(relation)):
-            rel = relation[i]
-            if rel == 'L':
-                newA.append(A[i][:])
-                newB.append(rhsB[i])
-            elif rel == 'E':
-                newA.append(A[i][:])
-                newB.append(rhsB[i])
-                newA.append(-1 * A[i][:])
-                newB.append(-1 * rhsB[i])
-            elif rel == 'G':
-                newA.append(-1 * A[i][:])
-                newB.append(-1 * rhsB[i])
-            else: 
-                raise Exception("Unsupported relation type")
-        
-        boundNames = res[10]
-        varBounds = res[11]
-
-        # print(np.array(newA))
-        # print(newB)
-
-        # Add variable bounds
-        for bddName in boundNames:
-            lowBound = varBounds[bddName]['LO']
-            highBound = varBounds[bddName]['UP']
-            assert(len(lowBound) == len(highBound))
-
-            numRealVars = len(lowBound)
-            numTotalVars = numRealVars
-
-            for i in range(numRealVars):
-                if lowBound[i] > 0:
-                    newA.append(-1 * np.eye(1, numTotalVars, i).flatten())
-                    newB.append(-1 * lowBound[i])
-                
-                if highBound[i] != np.inf:
-                    print(i)
-                    print(highBound[i])
-                    print("\n\n\n")
-                    newA.append(np.eye(1, numTotalVars, i).flatten())
-                    newB.append(highBound[i])
-                
-                if lowBound[i] == -np.inf and highBound[i] == np.inf:
-                    # replace this variable x_i with (x_i+ - x_i-)
-
-                    newC = np.append(newC, newC[i] * -1)
-
-                    # for all constraints with x, make the replacement
-                    # Since we have (n + 1) variables now, we add a column to A
-                    new_column = np.zeros((len(newA), 1))
-                    newA = np.append(newA, new_column, axis=1)
-
-                    # we still have len(relation) constraints
-                    for j in range(len(newA)):
-                        newA[j][-1] = -newA[j][i]
-                elif lowBound[i] < 0:
-                    # replace x_i >= lowBound[i] with x'i = x_i - lowBound[i] so x'_i >= 0
-                    # x_i = x'_i + lowBound[i]
-
-                    # update b accordingly
-                    # a * x_i means a * x'_i + a * lowBound[i] on the left hand side,
-                    # subtract b[j] by a * lowBound[i]
-                    for j in range(len(newB)):
-                        newB[j] -= lowBound[i] * newA[j][i]
-        
-        newA = np.array(newA)
-        # newA = np.tile(newA, 5)
-        newB = np.array(newB)
-        # newB = np.tile(newB, 5)
-        # print(newA)
-        # print(newB)
-        # print(newC)
-
-        # print(varBounds)
-        # print(boundNames)
-        writeArrays(test_locations + test_name + '_parsed.txt', newA, newB, newC)
-        return test_locations + test_name + '_parsed.txt'
-
-
-
-def genRandomInput(numVariables, numConstraints):
-    A = np.random.random((numConstraints, numVariables)) * 10000
-    b = np.random.random(numConstraints) * 10000
-    c = np.random.random(numVariables) * 10000
-    writeArrays('inputs/random_parsed.txt', A, b, c)
-    return 'inputs/random_parsed.txt'
-
-
 program = "simplex-" + sys.argv[0]
 workers = [16, 64, 128]
 
 test_locations = "inputs/"
-test_cases = ["israel.mps"]
+test_cases = ["israel.mps", "afiro.mpsc", "sc50a.mpsc"]
 
 for case in test_cases:
-    # input_file = parseInput(test_locations, case)
-    # input_file = genRandomInput(5000, 5000)
-    print("Generated inputs")
+    # The solvers read MPS models themselves
+    input_file = test_locations + case
 
     print("Sequential Version:")
-    # os.system("cat " + input_file + ' | ' + "./simplex-seq")
-    os.system("./simplex-seq")
+    os.system("./simplex-seq " + input_file)
 
     print("OpenMP Version:")
-
-    # os.system("cat " + input_file + ' | ' + "./simplex-openmp")
-    os.system("./simplex-openmp")
\ No newline at end of file
+    os.system("./simplex-openmp " + input_file)
+
+    # The primal against its dual, first to finish wins
+    print("OpenMP Race:")
+    os.system("SIMPLEX_RACE=on ./simplex-openmp " + input_file)
+
+# All the cases again in one process, solved side by side
+print("OpenMP Batch:")
+with tempfile.NamedTemporaryFile("w", suffix=".txt", delete=False) as manifest:
+    for case in test_cases:
+        manifest.write(test_locations + case + "\n")
+os.system("./simplex-openmp --batch " + manifest.name)
+os.remove(manifest.name)
+
+# Checks that fail the run: each compares what a solve prints with what it
+# should be.
+failures = 0
+
+
+def optimum(args, **env):
+    """The last optimum the solver run with args and env prints, or None."""
+    run = subprocess.run(args, env=dict(os.environ, **env),
+                         stdout=subprocess.PIPE, universal_newlines=True)
+    found = re.findall(r"The optimum is (\S+)", run.stdout)
+    return float(found[-1]) if found else None
+
+
+def solution(args, **env):
+    """The (optimum, objective, violation) the solver run with args and env
+    prints for its model's postsolved solution, or None."""
+    run = subprocess.run(args, env=dict(os.environ, **env),
+                         stdout=subprocess.PIPE, universal_newlines=True)
+    found = re.search(r"The optimum is (\S+).*?Solution: objective (\S+), "
+                      r"worst violation (\S+)", run.stdout, re.S)
+    return tuple(float(v) for v in found.groups()) if found else None
+
+
+def check(what, got, want):
+    global failures
+    ok = got is not None and abs(got - want) <= 1e-6 * max(1.0, abs(want))
+    print(("ok      " if ok else "FAILED  ") + what + ": " + str(got) +
+          ", want " + str(want))
+    if not ok:
+        failures += 1
+
+
+def check_at_most(what, got, limit):
+    global failures
+    ok = got is not None and got <= limit
+    print(("ok      " if ok else "FAILED  ") + what + ": " + str(got) +
+          ", want at most " + str(limit))
+    if not ok:
+        failures += 1
+
+
+def check_status(what, args, **env):
+    """Check that the solver run with args and env exits with status 0."""
+    global failures
+    run = subprocess.run(args, env=dict(os.environ, **env),
+                         stdout=subprocess.PIPE, universal_newlines=True)
+    ok = run.returncode == 0
+    print(("ok      " if ok else "FAILED  ") + what)
+    if not ok:
+        print(run.stdout)
+        failures += 1
+
+
+print("Checks:")
+
+# simplex-test covers what a solve's output doesn't show.
+subprocess.run(["make", "-s", "simplex-test"], check=True)
+check_status("simplex-test lu: LU factorization",
+             ["./simplex-test", "lu"])
+
+# The revised engine from a singular basis: twins.bas makes both of two
+# equal columns basic, and the factorization has to swap a slack in.
+twins = test_locations + "twins.mps"
+check("revised engine from a singular basis",
+      optimum(["./simplex-openmp", twins], SIMPLEX_ENGINE="revised",
+              SIMPLEX_PRESOLVE="off",
+              SIMPLEX_BASIS_IN=test_locations + "twins.bas"), -6)
+
+# A basis saved from the bounded tableau warm-starts the revised engine,
+# whose row form has other rows and columns: files go by the model's names.
+afiro = test_locations + "afiro.mpsc"
+with tempfile.NamedTemporaryFile(suffix=".bas", delete=False) as saved:
+    pass
+optimum(["./simplex-openmp", afiro], SIMPLEX_BASIS_OUT=saved.name)
+check("revised engine from the tableau's afiro basis",
+      optimum(["./simplex-openmp", afiro], SIMPLEX_ENGINE="revised",
+              SIMPLEX_BASIS_IN=saved.name), -464.753143)
+os.remove(saved.name)
+
+# lotfi, which presolve reduces: the solution postsolved to the model as
+# read keeps to its rows and bounds and has the optimum as its objective,
+# from each engine and from batch mode.
+lotfi = test_locations + "lotfi.mpsc"
+with tempfile.NamedTemporaryFile("w", suffix=".txt", delete=False) as manifest:
+    manifest.write(lotfi + "\n")
+runs = [("tableau", ["./simplex-openmp", lotfi], {}),
+        ("revised", ["./simplex-openmp", lotfi], {"SIMPLEX_ENGINE": "revised"}),
+        ("race", ["./simplex-openmp", lotfi], {"SIMPLEX_RACE": "on"}),
+        ("batch", ["./simplex-openmp", "--batch", manifest.name], {})]
+for name, args, env in runs:
+    found = solution(args, **env) or (None, None, None)
+    check("lotfi " + name + ": optimum", found[0], -25.264706)
+    check("lotfi " + name + ": postsolved x's objective", found[1], -25.264706)
+    check_at_most("lotfi " + name + ": postsolved x's worst violation",
+                  found[2], 1e-6)
+os.remove(manifest.name)
+
+# Random edits to a solved tableau (SetRhs, SetCost, SetBounds, AddCut,
+# RemoveRow, AddColumn, RemoveColumn), each re-solve checked against the
+# revised engine solving the edited problem from scratch, on bounded and
+# row-form tableaus and on one and several threads.
+edit_cases = [[test_locations + case] for case in test_cases] + [["30", "60"]]
+for args in edit_cases:
+    for form in ["bounded", "rows"]:
+        for threads in ["1", "4"]:
+            check_status("simplex-test edits: " + " ".join(args) + ", " +
+                         form + ", " + threads + " threads",
+                         ["./simplex-test", "edits", form, "28"] + args,
+                         OMP_NUM_THREADS=threads)
+
+sys.exit(1 if failures else 0)
@@ -0,0 +1,4 @@
+NAME          Twins
+ XU X         ROW1
+ XU Y         ROW2
+ENDATA
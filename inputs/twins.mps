@@ -0,0 +1,31 @@
+NAME          Twins
+*
+*  Minimize:
+*
+*      - x - y - 2 z
+*
+*  Subject to:
+*
+*      x + y +   z <= 4
+*      x + y + 2 z <= 6
+*              z <= 2.5
+*
+*  x and y are the same column, so a basis holding both is singular.
+*  The optimum is -6.
+*
+ROWS
+ N  COST
+ L  ROW1
+ L  ROW2
+ L  ROW3
+COLUMNS
+    X         COST              -1.0   ROW1               1.0
+    X         ROW2               1.0
+    Y         COST              -1.0   ROW1               1.0
+    Y         ROW2               1.0
+    Z         COST              -2.0   ROW1               1.0
+    Z         ROW2               2.0   ROW3               1.0
+RHS
+    RHS1      ROW1               4.0   ROW2               6.0
+    RHS1      ROW3               2.5
+ENDATA
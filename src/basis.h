@@ -0,0 +1,258 @@
+// A simplex basis, and reading and writing it as an MPS basis (BAS) file,
+// so a solve can start from the basis an earlier, similar one ended with.
+//
+// Variables are numbered as in the solvers: x_j for j < n, and the slack of
+// row i as n + i.  Files hold the basis in the model's terms instead, by
+// its own row and column names, so they don't depend on the standard form
+// (mps.h) the engine took or on which model the names are looked up in:
+// a file is read by name into whichever form the solve uses, and a name
+// the model doesn't have is an error.  As in other solvers' BAS files,
+// all rows are basic unless a line says otherwise, and nonbasic columns
+// are at their lower bound unless a line says upper.  A row is at a bound
+// when its activity is:
+//
+//   NAME          share2b
+//    XL X12       R7        X12 basic, R7 nonbasic at its lower bound
+//    XU X3        R9        X3 basic, R9 nonbasic at its upper bound
+//    UL X5                  X5 nonbasic at its upper bound
+//   ENDATA
+//
+// LL lines are checked and skipped.  A column with no finite lower bound
+// is nonbasic at its upper one (x = up - x') whatever the file says.
+
+#ifndef BASIS_H
+#define BASIS_H
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mps.h"
+
+struct Basis {
+    int m = 0, n = 0;
+    std::vector<int> basic; // the m basic variables
+    std::vector<int> upper; // nonbasic variables at their upper bound
+};
+
+// Where a basis has a model column or row.
+enum BasisStatus : char { BASIC, AT_LOWER, AT_UPPER };
+
+// Can model column j be nonbasic at its upper bound in sf?
+inline bool columnHasUpper(const StandardForm &sf, int j) {
+    int p = sf.pos[j];
+    if (p < 0)
+        return sf.neg[j] >= 0;
+    if (sf.neg[j] >= 0)
+        return false;
+    return sf.capRow[p] >= 0 ||
+           (!sf.bounds.upper.empty() && std::isfinite(sf.bounds.upper[p]));
+}
+
+// Can model row i be nonbasic at side (AT_LOWER or AT_UPPER) in sf?
+inline bool rowHasSide(const StandardForm &sf, int i, char side) {
+    int u = sf.upperRow[i];
+    if (side == AT_UPPER)
+        return u >= 0;
+    if (sf.lowerRow[i] >= 0)
+        return true;
+    // The bounded form's slack at its range.
+    return u >= 0 && !sf.bounds.range.empty() &&
+           std::isfinite(sf.bounds.range[u]);
+}
+
+// b, a basis of sf, in the model's terms: the status of each model column
+// and row.
+inline void modelBasis(const StandardForm &sf, const Basis &b,
+                       std::vector<char> &col, std::vector<char> &row) {
+    std::vector<char> isBasic(b.n + b.m, 0), atUpper(b.n + b.m, 0);
+    for (int v : b.basic)
+        isBasic[v] = 1;
+    for (int v : b.upper)
+        atUpper[v] = 1;
+    col.assign(sf.pos.size(), AT_LOWER);
+    for (size_t j = 0; j < col.size(); j++) {
+        int p = sf.pos[j], q = sf.neg[j];
+        if (p >= 0 && isBasic[p]) {
+            // In the row form x'_j is at its cap when its cap row's slack
+            // is nonbasic.
+            int c = sf.capRow[p];
+            col[j] = c >= 0 && !isBasic[b.n + c] ? AT_UPPER : BASIC;
+        } else if (q >= 0 && isBasic[q]) {
+            col[j] = BASIC;
+        } else if ((p >= 0 && atUpper[p]) || (p < 0 && q >= 0)) {
+            col[j] = AT_UPPER;
+        }
+    }
+    row.assign(sf.upperRow.size(), BASIC);
+    for (size_t i = 0; i < row.size(); i++) {
+        int u = sf.upperRow[i], l = sf.lowerRow[i];
+        if (u >= 0 && !isBasic[b.n + u])
+            row[i] = atUpper[b.n + u] ? AT_LOWER : AT_UPPER;
+        else if (l >= 0 && !isBasic[b.n + l])
+            row[i] = AT_LOWER;
+    }
+}
+
+// The basis of sf with the model's columns and rows where col and row say,
+// as far as columnHasUpper and rowHasSide allow.
+inline void standardBasis(const StandardForm &sf, const std::vector<char> &col,
+                          const std::vector<char> &row, Basis &b) {
+    int m = sf.m, n = sf.n;
+    std::vector<char> isBasic(n + m, 0);
+    for (int i = 0; i < m; i++)
+        isBasic[n + i] = 1;
+    b.m = m;
+    b.n = n;
+    b.basic.clear();
+    b.upper.clear();
+    for (size_t j = 0; j < col.size(); j++) {
+        int p = sf.pos[j], q = sf.neg[j];
+        if (col[j] == BASIC) {
+            isBasic[p >= 0 ? p : q] = 1;
+        } else if (col[j] == AT_UPPER && p >= 0) {
+            int c = sf.capRow[p];
+            if (c >= 0) {
+                isBasic[p] = 1;
+                isBasic[n + c] = 0;
+            } else {
+                b.upper.push_back(p);
+            }
+        }
+    }
+    for (size_t i = 0; i < row.size(); i++) {
+        int u = sf.upperRow[i], l = sf.lowerRow[i];
+        if (row[i] == AT_UPPER) {
+            isBasic[n + u] = 0;
+        } else if (row[i] == AT_LOWER) {
+            if (l >= 0) {
+                isBasic[n + l] = 0;
+            } else {
+                isBasic[n + u] = 0;
+                b.upper.push_back(n + u);
+            }
+        }
+    }
+    for (int v = 0; v < n + m; v++)
+        if (isBasic[v])
+            b.basic.push_back(v);
+}
+
+// Write b, a basis of sf, as a BAS file in the model's names.  Prints a
+// diagnostic and returns false on failure.
+inline bool writeBasis(const char *path, const Basis &b,
+                       const StandardForm &sf) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "can't write " << path << std::endl;
+        return false;
+    }
+    std::vector<char> col, row;
+    modelBasis(sf, b, col, row);
+    // Pair each basic column with a nonbasic row; a basis has as many of
+    // one as of the other, short of a degenerate one that has both x'_j
+    // and its cap row's slack nonbasic, whose spare rows are left basic.
+    std::vector<int> rows;
+    for (size_t i = 0; i < row.size(); i++)
+        if (row[i] != BASIC)
+            rows.push_back(i);
+    out << "NAME          " << sf.name << "\n" << std::left;
+    size_t k = 0;
+    for (size_t j = 0; j < col.size() && k < rows.size(); j++) {
+        if (col[j] != BASIC)
+            continue;
+        int i = rows[k++];
+        out << (row[i] == AT_UPPER ? " XU " : " XL ") << std::setw(8)
+            << sf.colNames[j] << "  " << sf.rowNames[i] << "\n";
+    }
+    for (size_t j = 0; j < col.size(); j++)
+        if (col[j] == AT_UPPER)
+            out << " UL " << sf.colNames[j] << "\n";
+    out << "ENDATA\n";
+    return (bool)out;
+}
+
+// Read a BAS file for sf's model into b, a basis of sf.  Prints a
+// diagnostic and returns false on failure, which includes a name sf's
+// model doesn't have and a bound the row or column lacks.
+inline bool readBasis(const char *path, const StandardForm &sf, Basis &b) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "can't open " << path << std::endl;
+        return false;
+    }
+    std::unordered_map<std::string, int> colIndex, rowIndex;
+    for (size_t j = 0; j < sf.colNames.size(); j++)
+        colIndex[sf.colNames[j]] = j;
+    for (size_t i = 0; i < sf.rowNames.size(); i++)
+        rowIndex[sf.rowNames[i]] = i;
+    std::vector<char> col(sf.colNames.size(), AT_LOWER),
+        row(sf.rowNames.size(), BASIC), listed(sf.colNames.size(), 0);
+
+    std::string line;
+    int lineNo = 0;
+    bool ended = false;
+    auto bad = [&]() {
+        std::cerr << path << ":" << lineNo << ": bad basis line: " << line
+                  << std::endl;
+        return false;
+    };
+    auto unknown = [&](const char *what, const std::string &name) {
+        std::cerr << path << ":" << lineNo << ": " << sf.name << " has no "
+                  << what << " " << name << std::endl;
+        return false;
+    };
+    while (!ended && std::getline(in, line)) {
+        lineNo++;
+        if (line.empty() || line[0] == '*')
+            continue;
+        std::istringstream fields(line);
+        std::string type, name, rowName;
+        fields >> type >> name >> rowName;
+        if (line[0] != ' ') {
+            if (type == "ENDATA")
+                ended = true;
+            else if (type != "NAME")
+                return bad();
+            continue;
+        }
+        auto c = colIndex.find(name);
+        if (c == colIndex.end())
+            return name.empty() ? bad() : unknown("column", name);
+        int j = c->second;
+        if (listed[j])
+            return bad();
+        listed[j] = 1;
+        if (type == "XL" || type == "XU") {
+            auto r = rowIndex.find(rowName);
+            if (r == rowIndex.end())
+                return rowName.empty() ? bad() : unknown("row", rowName);
+            int i = r->second;
+            char side = type == "XU" ? AT_UPPER : AT_LOWER;
+            if (row[i] != BASIC || !rowHasSide(sf, i, side))
+                return bad();
+            col[j] = BASIC;
+            row[i] = side;
+        } else if (type == "LL" || type == "UL") {
+            if (type == "UL" && !columnHasUpper(sf, j))
+                return bad();
+            col[j] = type == "UL" ? AT_UPPER : AT_LOWER;
+        } else {
+            return bad();
+        }
+    }
+    if (!ended) {
+        std::cerr << path << ": no ENDATA" << std::endl;
+        return false;
+    }
+    standardBasis(sf, col, row, b);
+    return true;
+}
+
+#endif
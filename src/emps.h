@@ -0,0 +1,511 @@
+// In-process decoder for netlib's compressed MPS format (.mpsc).
+//
+// This is the expansion logic of emps.c (David M. Gay's exform, exindx,
+// process and colout) turned into a class: instead of printing MPS to stdout
+// it hands each expanded line to a callback, so the model loader can read a
+// compressed file directly with no temporary file in between.  Check sums
+// are verified as in emps.c, mystery lines are dropped, blanks inside names
+// become '_' (emps -b) and only the first problem in a file is expanded.
+
+#ifndef EMPS_H
+#define EMPS_H
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+class MPSCDecoder {
+  public:
+    std::string error;
+
+    MPSCDecoder(std::istream &in0) : in(in0) {
+        for (int i = 0; i < 256; i++)
+            invtrtab[i] = 92;
+        for (int i = 0; trtab()[i]; i++)
+            invtrtab[(unsigned char)trtab()[i]] = i;
+        chkbuf[0] = ' ';
+    }
+
+    // Expand the first problem, passing each MPS line (without newline) to
+    // out.  Stops and returns false as soon as out does, or on bad input.
+    bool decode(std::function<bool(const char *)> out0) {
+        out = out0;
+        return process();
+    }
+
+  private:
+    static const char *trtab() {
+        return "!\"#$%&'()*+,-./0123456789;<=>?@"
+               "ABCDEFGHIJKLMNOPQRSTUVWXYZ[]^_`abcdefghijklmnopqrstuvwxyz{|}~";
+    }
+
+    std::istream &in;
+    std::function<bool(const char *)> out;
+    char invtrtab[256];
+    char chkbuf[76];
+    std::vector<long> fline;
+    int ncs = 1, cn = 0, kmax = -1;
+    bool canend = false;
+    long nline = 0, nrow = 0;
+
+    std::vector<char> numbers; // expanded number table, 16 bytes each
+    std::vector<char> names;   // row then column names, 8 bytes each
+    char outbuf[128];
+
+    int tr(char c) const { return invtrtab[(unsigned char)c]; }
+
+    bool scream(const std::string &msg) {
+        error = msg + ": line " + std::to_string(nline);
+        return false;
+    }
+
+    bool emit() { return out(outbuf) || scream("loader rejected line"); }
+
+    void checkchar(char *s) {
+        unsigned int x = 0;
+        int c;
+        for (; (c = *s); s++) {
+            if (c == '\n') {
+                *s = 0;
+                break;
+            }
+            c = tr(c);
+            if (x & 1)
+                x = (x >> 1) + c + 16384;
+            else
+                x = (x >> 1) + c;
+        }
+        fline.resize(ncs + 1);
+        fline[ncs] = nline;
+        chkbuf[ncs++] = trtab()[x % 92];
+    }
+
+    bool getline(char *s, int size) {
+        std::string line;
+        if (!std::getline(in, line))
+            return false;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if ((int)line.size() > size - 2)
+            line.resize(size - 2);
+        memcpy(s, line.c_str(), line.size());
+        s[line.size()] = '\n';
+        s[line.size() + 1] = 0;
+        return true;
+    }
+
+    bool checkline() {
+        char chklin[80];
+        canend = false;
+    again:
+        chkbuf[ncs++] = '\n';
+        chkbuf[ncs] = 0;
+        nline++;
+        if (!getline(chklin, 77))
+            return scream("premature end of file");
+        if (strcmp(chklin, chkbuf)) {
+            if (*chklin == ':' && ncs <= 72) {
+                ncs--;
+                checkchar(chklin);
+                goto again;
+            }
+            int i = 1;
+            if (*chklin == ' ')
+                while (chkbuf[i] == chklin[i])
+                    i++;
+            return scream("bad check sum for line " +
+                          std::to_string(i < (int)fline.size() ? fline[i] : 0));
+        }
+        ncs = 1;
+        return true;
+    }
+
+    // Returns 0 at a clean end of file (when allowed), else buf.
+    char *rdline(char *s, bool &ok) {
+        ok = true;
+    again:
+        nline++;
+        if (!getline(s, 79)) {
+            if (!canend)
+                ok = scream("premature end of file");
+            return 0;
+        }
+        checkchar(s);
+        if (ncs >= 72 && !checkline()) {
+            ok = false;
+            return 0;
+        }
+        if (*s == ':')
+            goto again;
+        return s;
+    }
+
+    static void blankfix(char *s) {
+        for (; *s; s++)
+            if (*s == ' ')
+                *s = '_';
+    }
+
+    int exindx(char **s) { // expand supersparse index; -1 on error
+        char *z = *s;
+        int k, x;
+
+        k = tr(*z++);
+        if (k >= 46) {
+            scream("exindx: bad index");
+            return -1;
+        }
+        if (k >= 23)
+            x = k - 23;
+        else {
+            x = k;
+            for (;;) {
+                k = tr(*z++);
+                x = x * 46 + k;
+                if (k >= 46) {
+                    x -= 46;
+                    break;
+                }
+            }
+        }
+        *s = z;
+        return x;
+    }
+
+    char *exform(char *s0, char **Z) { // expand *Z into s0; 0 on error
+        int ex, k, nd, nelim;
+        char *d, db[32], sbuf[32], *s;
+        long x, y = 0;
+        char *z = *Z;
+
+        d = db;
+        k = tr(*z++);
+        if (k < 46) { /* supersparse index */
+            k = exindx(Z);
+            if (k < 0)
+                return 0;
+            if (k < 1 || k > kmax) {
+                scream("index " + std::to_string(k) + " > kmax = " +
+                       std::to_string(kmax));
+                return 0;
+            }
+            return &numbers[(k - 1) << 4];
+        }
+        s = sbuf;
+        k -= 46;
+        if (k >= 23) {
+            *s++ = '-';
+            k -= 23;
+            nelim = 11;
+        } else
+            nelim = 12;
+        if (k >= 11) { /* integer floating-point */
+            k -= 11;
+            *d++ = '.';
+            if (k >= 6)
+                x = k - 6;
+            else {
+                x = k;
+                for (;;) {
+                    k = tr(*z++);
+                    x = x * 46 + k;
+                    if (k >= 46) {
+                        x -= 46;
+                        break;
+                    }
+                }
+            }
+            if (!x)
+                *d++ = '0';
+            else
+                do {
+                    *d++ = '0' + x % 10;
+                    x /= 10;
+                } while (x);
+            do
+                *s++ = *--d;
+            while (d > db);
+        } else { /* general floating-point */
+            ex = tr(*z++) - 50;
+            x = tr(*z++);
+            while (--k >= 0) {
+                if (x >= 100000000) {
+                    y = x;
+                    x = tr(*z++);
+                } else
+                    x = x * 92 + tr(*z++);
+            }
+            if (y) {
+                while (x > 1) {
+                    *d++ = x % 10 + '0';
+                    x /= 10;
+                }
+                for (;; y /= 10) {
+                    *d++ = y % 10 + '0';
+                    if (y < 10)
+                        break;
+                }
+            } else if (x)
+                for (;; x /= 10) {
+                    *d++ = x % 10 + '0';
+                    if (x < 10)
+                        break;
+                }
+            else
+                *d++ = '0';
+            nd = d - db + ex;
+            if (ex > 0) {
+                if (nd < nelim || ex < 3) {
+                    while (d > db)
+                        *s++ = *--d;
+                    do
+                        *s++ = '0';
+                    while (--ex);
+                    *s++ = '.';
+                } else
+                    goto Eout;
+            } else if (nd >= 0) {
+                while (--nd >= 0)
+                    *s++ = *--d;
+                *s++ = '.';
+                while (d > db)
+                    *s++ = *--d;
+            } else if (ex > -nelim) {
+                *s++ = '.';
+                while (++nd <= 0)
+                    *s++ = '0';
+                while (d > db)
+                    *s++ = *--d;
+            } else {
+            Eout:
+                ex += d - db - 1;
+                if (ex == -10)
+                    ex = -9;
+                else {
+                    if (ex > 9 && ex <= d - db + 8) {
+                        do {
+                            *s++ = *--d;
+                        } while (--ex > 9);
+                    }
+                    *s++ = *--d;
+                }
+                *s++ = '.';
+                while (d > db)
+                    *s++ = *--d;
+                *s++ = 'E';
+                if (ex < 0) {
+                    *s++ = '-';
+                    ex = -ex;
+                }
+                while (ex) {
+                    *d++ = '0' + ex % 10;
+                    ex /= 10;
+                }
+                while (d > db)
+                    *s++ = *--d;
+            }
+        }
+        *s = 0;
+        k = s - sbuf;
+        s = s0;
+        while (k++ < 12)
+            *s++ = ' ';
+        strcpy(s, sbuf);
+        *Z = z;
+        return s0;
+    }
+
+    bool namstore(long i, const char *s) {
+        if (i <= 0 || (size_t)(i << 3) >= names.size())
+            return scream("bad name index");
+        for (int k = 0; k < 8; k++)
+            if (!(names[(i << 3) + k] = s[k]))
+                break;
+        return true;
+    }
+
+    bool namfetch(long i, char s[8]) {
+        if (i <= 0 || (size_t)(i << 3) >= names.size())
+            return scream("bad name index");
+        strncpy(s, &names[i << 3], 8);
+        return true;
+    }
+
+    bool process() {
+        char buf[80], *b1, *z;
+        long ncol, colmx, nz, nrhs, rhsnz, nran, ranz, nbd, bdnz, ns;
+        bool ok;
+
+        /* NAME line */
+
+        do {
+            if (!rdline(buf, ok))
+                return ok ? scream("no NAME line") : false;
+        } while (strncmp(buf, "NAME", 4));
+        canend = false;
+        ncs = 1;
+        snprintf(outbuf, sizeof(outbuf), "%s", buf);
+        if (!emit())
+            return false;
+
+        /* problem statistics */
+
+        if (!rdline(buf, ok))
+            return false;
+        if (sscanf(buf, "%ld %ld %ld %ld %ld %ld %ld %ld", &nrow, &ncol,
+                   &colmx, &nz, &nrhs, &rhsnz, &nran, &ranz) != 8)
+            return scream("bad statistics line");
+        if (!rdline(buf, ok))
+            return false;
+        if (sscanf(buf, "%ld %ld %ld", &nbd, &bdnz, &ns) != 3)
+            return scream("bad statistics line");
+        ncs = 1;
+        cn = nrow;
+
+        /* read, expand number table */
+
+        numbers.assign(ns << 4, 0);
+        names.assign((nrow + ncol + 1) << 3, 0);
+        kmax = -1;
+        z = (char *)"";
+        for (long i = 0; i < ns; i++) {
+            if (!*z && !(z = rdline(buf, ok)))
+                return false;
+            if (!exform(&numbers[i << 4], &z))
+                return false;
+        }
+        kmax = ns;
+
+        /* read, emit row names */
+
+        b1 = buf + 1;
+        for (long i = 1; i <= nrow; i++) {
+            if (!rdline(buf, ok))
+                return false;
+            if (i == 1) {
+                snprintf(outbuf, sizeof(outbuf), "ROWS");
+                if (!emit())
+                    return false;
+            }
+            blankfix(b1);
+            snprintf(outbuf, sizeof(outbuf), " %c  %s", *buf, b1);
+            if (!emit() || !namstore(i, b1))
+                return false;
+        }
+
+        if (!colout("COLUMNS", nz, 1) || !colout("RHS", rhsnz, 2) ||
+            !colout("RANGES", ranz, 3) || !colout("BOUNDS", bdnz, 4))
+            return false;
+
+        /* final checksum line... */
+
+        if (ncs > 1 && !checkline())
+            return false;
+
+        snprintf(outbuf, sizeof(outbuf), "ENDATA");
+        return emit();
+    }
+
+    bool colout(const char *head, long nz, int what) {
+        static const char *bt[] = {"UP", "LO", "FX", "FR", "MI", "PL"};
+        static const char fmt2[] =
+            "    %-8.8s  %-8.8s  %-15.15s%-8.8s  %.15s";
+        char buf[80], curcol[9], *rc1 = 0, *rc2 = 0, rcbuf1[16], rcbuf2[16],
+            rownm[2][9], *z;
+        int first, k, n;
+        bool ok;
+
+        if (!nz) {
+            if (what <= 2) {
+                snprintf(outbuf, sizeof(outbuf), "%s", head);
+                return emit();
+            }
+            return true;
+        }
+
+        first = 1;
+        k = 0;
+        z = (char *)"";
+        memset(curcol, 0, sizeof(curcol));
+        memset(rownm, 0, sizeof(rownm));
+        while (nz--) {
+            if (!*z && !(z = rdline(buf, ok)))
+                return false;
+            if (first) {
+                snprintf(outbuf, sizeof(outbuf), "%s", head);
+                if (!emit())
+                    return false;
+                first = 0;
+            }
+            while (!(n = exindx(&z))) {
+                if (k) {
+                    snprintf(outbuf, sizeof(outbuf),
+                             "    %-8.8s  %-8.8s  %.15s", curcol, rownm[0],
+                             rc1);
+                    if (!emit())
+                        return false;
+                    k = 0;
+                }
+                if (*z)
+                    blankfix(z);
+                else
+                    z = (char *)head;
+                strncpy(curcol, z, 8);
+                if (what == 1 && !namstore(++cn, z))
+                    return false;
+                if (!(z = rdline(buf, ok)))
+                    return false;
+            }
+            if (n < 0)
+                return false;
+            if (what >= 4) {
+                if (n >= 7)
+                    return scream("bad bound type index = " +
+                                  std::to_string(n));
+                if (!*z && !(z = rdline(buf, ok)))
+                    return false;
+                int j = exindx(&z);
+                if (j < 0 || !namfetch(nrow + j, rownm[0]))
+                    return false;
+                if (n-- >= 4) {
+                    snprintf(outbuf, sizeof(outbuf), " %s %-8.8s  %.8s",
+                             bt[n], curcol, *rownm);
+                    if (!emit())
+                        return false;
+                    continue;
+                }
+            } else if (!namfetch(n, rownm[k]))
+                return false;
+            if (!*z && !(z = rdline(buf, ok)))
+                return false;
+            if (k)
+                rc2 = exform(rcbuf2, &z);
+            else
+                rc1 = exform(rcbuf1, &z);
+            if (!(k ? rc2 : rc1))
+                return false;
+            if (what <= 3) {
+                if (++k == 1)
+                    continue;
+                snprintf(outbuf, sizeof(outbuf), fmt2, curcol, rownm[0], rc1,
+                         rownm[1], rc2);
+                k = 0;
+            } else
+                snprintf(outbuf, sizeof(outbuf), " %s %-8.8s  %-8.8s  %.15s",
+                         bt[n], curcol, rownm[0], rc1);
+            if (!emit())
+                return false;
+        }
+        if (k) {
+            snprintf(outbuf, sizeof(outbuf), "    %-8.8s  %-8.8s  %.15s",
+                     curcol, *rownm, rc1);
+            return emit();
+        }
+        return true;
+    }
+};
+
+#endif
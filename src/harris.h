@@ -0,0 +1,206 @@
+// Harris two-pass ratio test and right-hand side perturbation for the
+// tableau Simplex.
+//
+// The textbook test takes the smallest b_i / a_ic, however small a_ic is,
+// and on degenerate problems (many b_i == 0) keeps making zero-length
+// steps.  Harris's first pass finds the longest step that leaves every
+// basic variable >= -delta (a feasibility tolerance); the second pass then
+// takes, among the rows that block no later than that, the one with the
+// largest pivot.  Basic variables may go slightly negative, within delta.
+//
+// Perturbing b by a small random amount before solving breaks the ties
+// that make degenerate steps; Simplex takes it back out once optimal, along
+// with the shifts that keep a pivot on a row just below 0 from stepping
+// backwards.
+//
+// Phase 1 uses the same test: it maximizes the sum of the infeasibilities
+// of the basic variables, so one outside its bounds also blocks where it
+// gets back to them.  Upper bounds are native (see Simplex), so a basic
+// variable can leave at either bound.
+//
+// SIMPLEX_RATIO=textbook turns both off.
+
+#ifndef HARRIS_H
+#define HARRIS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "kernels.h"
+#include "topk.h"
+
+namespace harris {
+
+// Basic variables may be this far below zero.
+const double FEAS_TOL = 1e-7;
+// Smallest pivot either pass will take.
+const double PIVOT_TOL = 1e-7;
+// Relative size of the perturbation of b.
+const double PERTURB = 1e-6;
+
+inline bool enabled() {
+    const char *env = getenv("SIMPLEX_RATIO");
+    return !(env && strcmp(env, "textbook") == 0);
+}
+
+// Both passes look at num/den[i * stride] for i in [begin, end), as the
+// kernels' scans do, with row i's basic variable kept in [lower[i],
+// upper[i]]: lower is 0, or -INFINITY for a free variable, and upper may be
+// INFINITY.  The entering variable moves row i by -den per unit step.  A
+// feasible row (within delta of its bounds) blocks where it reaches the
+// bound it moves toward, by more than tol; an infeasible one, which only
+// happens in phase 1, where it gets back to the bound it is outside.
+
+// Row (b, d)'s step to the bound it blocks at, as pass 2 measures it, or
+// INFINITY if it doesn't block.  A feasible row just outside its bound
+// counts as on it: it is shifted there before the pivot.
+inline double step(double b, double d, double l, double u, double tol,
+                   double delta) {
+    if (d > tol && b > u + delta)
+        return (b - u) / d;
+    if (d > tol)
+        return b >= l - delta ? std::max(b - l, 0.0) / d : INFINITY;
+    if (d < -tol && b < l - delta)
+        return (b - l) / d;
+    if (d < -tol)
+        return b <= u + delta ? std::max(u - b, 0.0) / -d : INFINITY;
+    return INFINITY;
+}
+
+// Pass 1: the longest step allowed, with feasible rows given delta of
+// slack.  If steps isn't null, the same pass offers it each row's step(),
+// so pass 2 can often choose from the shortest of them (pickFrom) instead
+// of going over the column again.
+template <class T>
+inline Compare bound(const T *num, const T *den, ptrdiff_t stride,
+                     const double *lower, const double *upper, int begin,
+                     int end, double tol, double delta, Compare best,
+                     TopK *steps = nullptr) {
+    for (int i = begin; i < end; i++) {
+        double d = den[i * stride], b = num[i * stride], v;
+        double l = lower[i], u = upper[i];
+        if (steps) {
+            double s = step(b, d, l, u, tol, delta);
+            if (s != INFINITY)
+                steps->offer(s, i);
+        }
+        if (d > tol && b > u + delta)
+            v = (b - u) / d;
+        else if (d > tol && b >= l - delta)
+            v = (b - l + delta) / d;
+        else if (d < -tol && b < l - delta)
+            v = (b - l) / d;
+        else if (d < -tol && b <= u + delta)
+            v = (b - u - delta) / d;
+        else
+            continue;
+        if (v < best.val) {
+            best.val = v;
+            best.index = i;
+        }
+    }
+    return best;
+}
+
+// Pass 2: the largest |den| among the rows that block by limit.
+template <class T>
+inline Compare pick(const T *num, const T *den, ptrdiff_t stride,
+                    const double *lower, const double *upper, int begin,
+                    int end, double tol, double delta, double limit,
+                    Compare best) {
+    for (int i = begin; i < end; i++) {
+        double d = den[i * stride];
+        // The step is computed as in pass 1, so its own row always
+        // qualifies.
+        if (step(num[i * stride], d, lower[i], upper[i], tol, delta) <=
+                limit &&
+            std::fabs(d) > best.val) {
+            best.val = std::fabs(d);
+            best.index = i;
+        }
+    }
+    return best;
+}
+
+// Pass 2 over the shortest steps pass 1 offered (all threads' merged,
+// best first), if they are every row that blocks by limit: false, leaving
+// best alone, if steps turned a row away that might.  Picks the same row
+// as pick() would.
+template <class T>
+inline bool pickFrom(const TopK &steps, const T *den, ptrdiff_t stride,
+                     double limit, Compare &best) {
+    if (steps.full() && steps[steps.size() - 1].val <= limit)
+        return false;
+    for (const Compare &s : steps) {
+        double d = std::fabs(den[s.index * stride]);
+        if (s.val <= limit &&
+            (d > best.val || (d == best.val && s.index < best.index))) {
+            best.val = d;
+            best.index = s.index;
+        }
+    }
+    return true;
+}
+
+// Does the blocking row (b, d) leave its basis at its upper bound?
+inline bool leavesAtUpper(double b, double d, double lower, double upper,
+                          double delta) {
+    return d < 0 ? b >= lower - delta : b > upper + delta;
+}
+
+// The dual ratio test, for Simplex's dual simplex: the entering column
+// for pivot row r is where a reduced cost d_j <= 0 in row m first reaches 0
+// as the step grows, over the columns with alpha_j = A[r][j] < -tol.  Row m
+// may sit up to delta above 0, and pass 2 counts those columns as at 0.
+
+// Pass 1: the longest step, min (d_j - delta) / alpha_j, or 0 for a d_j
+// that round-off left above delta.
+template <class T>
+inline Compare dualBound(const T *d, const T *alpha, int begin, int end,
+                         double tol, double delta, Compare best) {
+    for (int j = begin; j < end; j++) {
+        if (alpha[j] < -tol) {
+            double v = std::min(d[j] - delta, 0.0) / alpha[j];
+            if (v < best.val) {
+                best.val = v;
+                best.index = j;
+            }
+        }
+    }
+    return best;
+}
+
+// Pass 2: the largest |alpha_j| among the columns that block by limit.
+template <class T>
+inline Compare dualPick(const T *d, const T *alpha, int begin, int end,
+                        double tol, double limit, Compare best) {
+    for (int j = begin; j < end; j++) {
+        double a = alpha[j], dj = d[j];
+        if (a < -tol && std::min(dj, 0.0) / a <= limit && -a > best.val) {
+            best.val = -a;
+            best.index = j;
+        }
+    }
+    return best;
+}
+
+// Perturbation for each of b's m entries: up to PERTURB * (1 + |b_i|),
+// always positive, so the constraints only loosen.
+template <class T>
+inline std::vector<double> perturbation(const T *b, ptrdiff_t stride, int m) {
+    std::mt19937 gen(12345);
+    std::uniform_real_distribution<double> u(0.5, 1.0);
+    std::vector<double> delta(m);
+    for (int i = 0; i < m; i++)
+        delta[i] = PERTURB * (1 + std::fabs(b[i * stride])) * u(gen);
+    return delta;
+}
+
+} // namespace harris
+
+#endif
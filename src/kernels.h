@@ -0,0 +1,500 @@
+// Hand-vectorized kernels for the tableau updates in Pivot, and the
+// index-tracking scans used for pricing and the ratio test.
+//
+// Each kernel has a scalar version plus AVX2/FMA and AVX-512 versions built
+// with per-function target attributes, so the Makefile's plain -O2 build
+// still gets wide FMA code.  The widest version the CPU supports is picked
+// once at startup; SIMPLEX_ISA=scalar|avx2|avx512 overrides it for
+// benchmarking.  Non-x86 builds only get the scalar versions.
+//
+// There is a set for a float tableau too (get<float>()), with twice the
+// lanes in the two row updates; its scans are the scalar ones.
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMPLEX_X86 1
+#include <immintrin.h>
+#endif
+
+// A value found by one of the argmin/argmax scans and where it was found.
+struct Compare {
+    double val;
+    int index;
+};
+
+namespace kernels {
+
+// x[0..n) *= s
+template <class T> inline void scaleScalar(T *x, double s, int n) {
+    T t = (T)s;
+    for (int j = 0; j < n; j++)
+        x[j] *= t;
+}
+
+// y[0..n) -= a * x[0..n)
+template <class T>
+inline void subMulScalar(T *y, double a, const T *x, int n) {
+    T t = (T)a;
+    for (int j = 0; j < n; j++)
+        y[j] -= t * x[j];
+}
+
+// The scans below look at x[i * stride] for i in [begin, end) and return
+// the best value strictly better than best.val, or best unchanged.  Ties go
+// to the smallest index, as in a plain sequential loop.
+
+// Largest x[i] (x contiguous).
+template <class T>
+inline Compare argmaxScalar(const T *x, int begin, int end, Compare best) {
+    for (int i = begin; i < end; i++) {
+        if (x[i] > best.val) {
+            best.val = x[i];
+            best.index = i;
+        }
+    }
+    return best;
+}
+
+// Smallest x[i * stride].
+template <class T>
+inline Compare argminScalar(const T *x, ptrdiff_t stride, int begin, int end,
+                            Compare best) {
+    for (int i = begin; i < end; i++) {
+        double v = x[i * stride];
+        if (v < best.val) {
+            best.val = v;
+            best.index = i;
+        }
+    }
+    return best;
+}
+
+// Ratio test: smallest num[i * stride] / den[i * stride] over den > eps.
+template <class T>
+inline Compare minRatioScalar(const T *num, const T *den, ptrdiff_t stride,
+                              int begin, int end, double eps, Compare best) {
+    for (int i = begin; i < end; i++) {
+        if (den[i * stride] > eps) {
+            double v = num[i * stride] / den[i * stride];
+            if (v < best.val) {
+                best.val = v;
+                best.index = i;
+            }
+        }
+    }
+    return best;
+}
+
+// Fold per-lane winners into best; lanes that never won hold index -1.
+template <bool MAX>
+inline Compare reduceLanes(const double *val, const double *idx, int lanes,
+                           Compare best) {
+    Compare found = best;
+    bool any = false;
+    for (int l = 0; l < lanes; l++) {
+        if (idx[l] < 0)
+            continue;
+        int i = (int)idx[l];
+        bool better = MAX ? val[l] > found.val : val[l] < found.val;
+        if (!any || better || (val[l] == found.val && i < found.index)) {
+            found.val = val[l];
+            found.index = i;
+            any = true;
+        }
+    }
+    return found;
+}
+
+#ifdef SIMPLEX_X86
+__attribute__((target("avx2,fma"))) inline void scaleAVX2(double *x, double s,
+                                                          int n) {
+    __m256d vs = _mm256_set1_pd(s);
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+        _mm256_storeu_pd(x + j, _mm256_mul_pd(_mm256_loadu_pd(x + j), vs));
+        _mm256_storeu_pd(x + j + 4,
+                         _mm256_mul_pd(_mm256_loadu_pd(x + j + 4), vs));
+    }
+    for (; j < n; j++)
+        x[j] *= s;
+}
+
+__attribute__((target("avx2,fma"))) inline void
+subMulAVX2(double *y, double a, const double *x, int n) {
+    __m256d va = _mm256_set1_pd(a);
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m256d y0 = _mm256_loadu_pd(y + j);
+        __m256d y1 = _mm256_loadu_pd(y + j + 4);
+        y0 = _mm256_fnmadd_pd(va, _mm256_loadu_pd(x + j), y0);
+        y1 = _mm256_fnmadd_pd(va, _mm256_loadu_pd(x + j + 4), y1);
+        _mm256_storeu_pd(y + j, y0);
+        _mm256_storeu_pd(y + j + 4, y1);
+    }
+    for (; j < n; j++)
+        y[j] -= a * x[j];
+}
+
+__attribute__((target("avx512f"))) inline void scaleAVX512(double *x, double s,
+                                                           int n) {
+    __m512d vs = _mm512_set1_pd(s);
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+        _mm512_storeu_pd(x + j, _mm512_mul_pd(_mm512_loadu_pd(x + j), vs));
+        _mm512_storeu_pd(x + j + 8,
+                         _mm512_mul_pd(_mm512_loadu_pd(x + j + 8), vs));
+    }
+    for (; j + 8 <= n; j += 8)
+        _mm512_storeu_pd(x + j, _mm512_mul_pd(_mm512_loadu_pd(x + j), vs));
+    if (j < n) {
+        __mmask8 k = (__mmask8)((1u << (n - j)) - 1);
+        __m512d v = _mm512_maskz_loadu_pd(k, x + j);
+        _mm512_mask_storeu_pd(x + j, k, _mm512_mul_pd(v, vs));
+    }
+}
+
+__attribute__((target("avx512f"))) inline void
+subMulAVX512(double *y, double a, const double *x, int n) {
+    __m512d va = _mm512_set1_pd(a);
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+        __m512d y0 = _mm512_loadu_pd(y + j);
+        __m512d y1 = _mm512_loadu_pd(y + j + 8);
+        y0 = _mm512_fnmadd_pd(va, _mm512_loadu_pd(x + j), y0);
+        y1 = _mm512_fnmadd_pd(va, _mm512_loadu_pd(x + j + 8), y1);
+        _mm512_storeu_pd(y + j, y0);
+        _mm512_storeu_pd(y + j + 8, y1);
+    }
+    for (; j + 8 <= n; j += 8) {
+        __m512d y0 = _mm512_loadu_pd(y + j);
+        y0 = _mm512_fnmadd_pd(va, _mm512_loadu_pd(x + j), y0);
+        _mm512_storeu_pd(y + j, y0);
+    }
+    if (j < n) {
+        __mmask8 k = (__mmask8)((1u << (n - j)) - 1);
+        __m512d y0 = _mm512_maskz_loadu_pd(k, y + j);
+        y0 = _mm512_fnmadd_pd(va, _mm512_maskz_loadu_pd(k, x + j), y0);
+        _mm512_mask_storeu_pd(y + j, k, y0);
+    }
+}
+
+__attribute__((target("avx2,fma"))) inline void scaleAVX2(float *x, double s,
+                                                          int n) {
+    __m256 vs = _mm256_set1_ps((float)s);
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+        _mm256_storeu_ps(x + j, _mm256_mul_ps(_mm256_loadu_ps(x + j), vs));
+        _mm256_storeu_ps(x + j + 8,
+                         _mm256_mul_ps(_mm256_loadu_ps(x + j + 8), vs));
+    }
+    for (; j < n; j++)
+        x[j] *= (float)s;
+}
+
+__attribute__((target("avx2,fma"))) inline void
+subMulAVX2(float *y, double a, const float *x, int n) {
+    __m256 va = _mm256_set1_ps((float)a);
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+        __m256 y0 = _mm256_loadu_ps(y + j);
+        __m256 y1 = _mm256_loadu_ps(y + j + 8);
+        y0 = _mm256_fnmadd_ps(va, _mm256_loadu_ps(x + j), y0);
+        y1 = _mm256_fnmadd_ps(va, _mm256_loadu_ps(x + j + 8), y1);
+        _mm256_storeu_ps(y + j, y0);
+        _mm256_storeu_ps(y + j + 8, y1);
+    }
+    for (; j < n; j++)
+        y[j] -= (float)a * x[j];
+}
+
+__attribute__((target("avx512f"))) inline void scaleAVX512(float *x, double s,
+                                                           int n) {
+    __m512 vs = _mm512_set1_ps((float)s);
+    int j = 0;
+    for (; j + 16 <= n; j += 16)
+        _mm512_storeu_ps(x + j, _mm512_mul_ps(_mm512_loadu_ps(x + j), vs));
+    if (j < n) {
+        __mmask16 k = (__mmask16)((1u << (n - j)) - 1);
+        __m512 v = _mm512_maskz_loadu_ps(k, x + j);
+        _mm512_mask_storeu_ps(x + j, k, _mm512_mul_ps(v, vs));
+    }
+}
+
+__attribute__((target("avx512f"))) inline void
+subMulAVX512(float *y, double a, const float *x, int n) {
+    __m512 va = _mm512_set1_ps((float)a);
+    int j = 0;
+    for (; j + 32 <= n; j += 32) {
+        __m512 y0 = _mm512_loadu_ps(y + j);
+        __m512 y1 = _mm512_loadu_ps(y + j + 16);
+        y0 = _mm512_fnmadd_ps(va, _mm512_loadu_ps(x + j), y0);
+        y1 = _mm512_fnmadd_ps(va, _mm512_loadu_ps(x + j + 16), y1);
+        _mm512_storeu_ps(y + j, y0);
+        _mm512_storeu_ps(y + j + 16, y1);
+    }
+    for (; j + 16 <= n; j += 16) {
+        __m512 y0 = _mm512_loadu_ps(y + j);
+        y0 = _mm512_fnmadd_ps(va, _mm512_loadu_ps(x + j), y0);
+        _mm512_storeu_ps(y + j, y0);
+    }
+    if (j < n) {
+        __mmask16 k = (__mmask16)((1u << (n - j)) - 1);
+        __m512 y0 = _mm512_maskz_loadu_ps(k, y + j);
+        y0 = _mm512_fnmadd_ps(va, _mm512_maskz_loadu_ps(k, x + j), y0);
+        _mm512_mask_storeu_ps(y + j, k, y0);
+    }
+}
+
+// AVX2 has no mask registers: winners are tracked with blends, and indices
+// are kept as doubles (exact below 2^53) so they blend with the values.
+__attribute__((target("avx2,fma"))) inline __m256d
+loadAVX2(const double *x, ptrdiff_t stride, __m256i off) {
+    return stride == 1 ? _mm256_loadu_pd(x) : _mm256_i64gather_pd(x, off, 8);
+}
+
+__attribute__((target("avx2,fma"))) inline Compare
+argmaxAVX2(const double *x, int begin, int end, Compare best) {
+    __m256d bestV = _mm256_set1_pd(best.val);
+    __m256d bestI = _mm256_set1_pd(-1);
+    __m256d idx = _mm256_setr_pd(begin, begin + 1, begin + 2, begin + 3);
+    __m256d four = _mm256_set1_pd(4);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        __m256d gt = _mm256_cmp_pd(v, bestV, _CMP_GT_OQ);
+        bestV = _mm256_blendv_pd(bestV, v, gt);
+        bestI = _mm256_blendv_pd(bestI, idx, gt);
+        idx = _mm256_add_pd(idx, four);
+    }
+    double val[4], ind[4];
+    _mm256_storeu_pd(val, bestV);
+    _mm256_storeu_pd(ind, bestI);
+    return argmaxScalar(x, i, end, reduceLanes<true>(val, ind, 4, best));
+}
+
+__attribute__((target("avx2,fma"))) inline Compare
+argminAVX2(const double *x, ptrdiff_t stride, int begin, int end,
+           Compare best) {
+    __m256d bestV = _mm256_set1_pd(best.val);
+    __m256d bestI = _mm256_set1_pd(-1);
+    __m256d idx = _mm256_setr_pd(begin, begin + 1, begin + 2, begin + 3);
+    __m256d four = _mm256_set1_pd(4);
+    __m256i off = _mm256_setr_epi64x(0, stride, 2 * stride, 3 * stride);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m256d v = loadAVX2(x + i * stride, stride, off);
+        __m256d lt = _mm256_cmp_pd(v, bestV, _CMP_LT_OQ);
+        bestV = _mm256_blendv_pd(bestV, v, lt);
+        bestI = _mm256_blendv_pd(bestI, idx, lt);
+        idx = _mm256_add_pd(idx, four);
+    }
+    double val[4], ind[4];
+    _mm256_storeu_pd(val, bestV);
+    _mm256_storeu_pd(ind, bestI);
+    return argminScalar(x, stride, i, end,
+                        reduceLanes<false>(val, ind, 4, best));
+}
+
+__attribute__((target("avx2,fma"))) inline Compare
+minRatioAVX2(const double *num, const double *den, ptrdiff_t stride,
+             int begin, int end, double eps, Compare best) {
+    __m256d bestV = _mm256_set1_pd(best.val);
+    __m256d bestI = _mm256_set1_pd(-1);
+    __m256d idx = _mm256_setr_pd(begin, begin + 1, begin + 2, begin + 3);
+    __m256d four = _mm256_set1_pd(4);
+    __m256d veps = _mm256_set1_pd(eps);
+    __m256i off = _mm256_setr_epi64x(0, stride, 2 * stride, 3 * stride);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m256d d = loadAVX2(den + i * stride, stride, off);
+        __m256d ok = _mm256_cmp_pd(d, veps, _CMP_GT_OQ);
+        if (!_mm256_movemask_pd(ok)) {
+            idx = _mm256_add_pd(idx, four);
+            continue;
+        }
+        __m256d v = _mm256_div_pd(loadAVX2(num + i * stride, stride, off), d);
+        __m256d lt = _mm256_and_pd(ok, _mm256_cmp_pd(v, bestV, _CMP_LT_OQ));
+        bestV = _mm256_blendv_pd(bestV, v, lt);
+        bestI = _mm256_blendv_pd(bestI, idx, lt);
+        idx = _mm256_add_pd(idx, four);
+    }
+    double val[4], ind[4];
+    _mm256_storeu_pd(val, bestV);
+    _mm256_storeu_pd(ind, bestI);
+    return minRatioScalar(num, den, stride, i, end, eps,
+                          reduceLanes<false>(val, ind, 4, best));
+}
+
+__attribute__((target("avx512f"))) inline __m512d
+loadAVX512(const double *x, ptrdiff_t stride, __m512i off) {
+    // The masked gather with a zero source keeps g++ from warning about
+    // the undefined source register of the plain one.
+    return stride == 1 ? _mm512_loadu_pd(x)
+                       : _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF,
+                                                  off, x, 8);
+}
+
+__attribute__((target("avx512f"))) inline Compare
+argmaxAVX512(const double *x, int begin, int end, Compare best) {
+    __m512d bestV = _mm512_set1_pd(best.val);
+    __m512d bestI = _mm512_set1_pd(-1);
+    __m512d idx = _mm512_add_pd(_mm512_set1_pd(begin),
+                                _mm512_setr_pd(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512d eight = _mm512_set1_pd(8);
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m512d v = _mm512_loadu_pd(x + i);
+        __mmask8 gt = _mm512_cmp_pd_mask(v, bestV, _CMP_GT_OQ);
+        bestV = _mm512_mask_mov_pd(bestV, gt, v);
+        bestI = _mm512_mask_mov_pd(bestI, gt, idx);
+        idx = _mm512_add_pd(idx, eight);
+    }
+    double val[8], ind[8];
+    _mm512_storeu_pd(val, bestV);
+    _mm512_storeu_pd(ind, bestI);
+    return argmaxScalar(x, i, end, reduceLanes<true>(val, ind, 8, best));
+}
+
+__attribute__((target("avx512f"))) inline Compare
+argminAVX512(const double *x, ptrdiff_t stride, int begin, int end,
+             Compare best) {
+    __m512d bestV = _mm512_set1_pd(best.val);
+    __m512d bestI = _mm512_set1_pd(-1);
+    __m512d idx = _mm512_add_pd(_mm512_set1_pd(begin),
+                                _mm512_setr_pd(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512d eight = _mm512_set1_pd(8);
+    __m512i off = _mm512_setr_epi64(0, stride, 2 * stride, 3 * stride,
+                                    4 * stride, 5 * stride, 6 * stride,
+                                    7 * stride);
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m512d v = loadAVX512(x + i * stride, stride, off);
+        __mmask8 lt = _mm512_cmp_pd_mask(v, bestV, _CMP_LT_OQ);
+        bestV = _mm512_mask_mov_pd(bestV, lt, v);
+        bestI = _mm512_mask_mov_pd(bestI, lt, idx);
+        idx = _mm512_add_pd(idx, eight);
+    }
+    double val[8], ind[8];
+    _mm512_storeu_pd(val, bestV);
+    _mm512_storeu_pd(ind, bestI);
+    return argminScalar(x, stride, i, end,
+                        reduceLanes<false>(val, ind, 8, best));
+}
+
+__attribute__((target("avx512f"))) inline Compare
+minRatioAVX512(const double *num, const double *den, ptrdiff_t stride,
+               int begin, int end, double eps, Compare best) {
+    __m512d bestV = _mm512_set1_pd(best.val);
+    __m512d bestI = _mm512_set1_pd(-1);
+    __m512d idx = _mm512_add_pd(_mm512_set1_pd(begin),
+                                _mm512_setr_pd(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512d eight = _mm512_set1_pd(8);
+    __m512d veps = _mm512_set1_pd(eps);
+    __m512i off = _mm512_setr_epi64(0, stride, 2 * stride, 3 * stride,
+                                    4 * stride, 5 * stride, 6 * stride,
+                                    7 * stride);
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m512d d = loadAVX512(den + i * stride, stride, off);
+        __mmask8 ok = _mm512_cmp_pd_mask(d, veps, _CMP_GT_OQ);
+        if (ok) {
+            __m512d v = _mm512_maskz_div_pd(
+                ok, loadAVX512(num + i * stride, stride, off), d);
+            __mmask8 lt = _mm512_mask_cmp_pd_mask(ok, v, bestV, _CMP_LT_OQ);
+            bestV = _mm512_mask_mov_pd(bestV, lt, v);
+            bestI = _mm512_mask_mov_pd(bestI, lt, idx);
+        }
+        idx = _mm512_add_pd(idx, eight);
+    }
+    double val[8], ind[8];
+    _mm512_storeu_pd(val, bestV);
+    _mm512_storeu_pd(ind, bestI);
+    return minRatioScalar(num, den, stride, i, end, eps,
+                          reduceLanes<false>(val, ind, 8, best));
+}
+#endif
+
+template <class T> struct Kernels {
+    const char *isa;
+    void (*scale)(T *x, double s, int n);
+    void (*subMul)(T *y, double a, const T *x, int n);
+    Compare (*argmax)(const T *x, int begin, int end, Compare best);
+    Compare (*argmin)(const T *x, ptrdiff_t stride, int begin, int end,
+                      Compare best);
+    Compare (*minRatio)(const T *num, const T *den, ptrdiff_t stride,
+                        int begin, int end, double eps, Compare best);
+};
+typedef Kernels<double> Table;
+
+enum ISA { SCALAR, AVX2, AVX512 };
+
+// The widest ISA the CPU supports, or SIMPLEX_ISA's if narrower.
+inline ISA pickISA() {
+#ifdef SIMPLEX_X86
+    __builtin_cpu_init();
+    bool hasAVX2 =
+        __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    bool hasAVX512 = hasAVX2 && __builtin_cpu_supports("avx512f");
+
+    const char *want = getenv("SIMPLEX_ISA");
+    if (want && !strcmp(want, "scalar"))
+        return SCALAR;
+    if (want && !strcmp(want, "avx2") && hasAVX2)
+        return AVX2;
+    if (hasAVX512)
+        return AVX512;
+    if (hasAVX2)
+        return AVX2;
+#endif
+    return SCALAR;
+}
+
+template <class T> Kernels<T> pick(ISA isa);
+
+template <> inline Kernels<double> pick<double>(ISA isa) {
+#ifdef SIMPLEX_X86
+    if (isa == AVX512)
+        return {"avx512",     scaleAVX512,  subMulAVX512,
+                argmaxAVX512, argminAVX512, minRatioAVX512};
+    if (isa == AVX2)
+        return {"avx2",     scaleAVX2,  subMulAVX2,
+                argmaxAVX2, argminAVX2, minRatioAVX2};
+#endif
+    return {"scalar",             scaleScalar<double>,
+            subMulScalar<double>, argmaxScalar<double>,
+            argminScalar<double>, minRatioScalar<double>};
+}
+
+template <> inline Kernels<float> pick<float>(ISA isa) {
+    Kernels<float> k = {"scalar",            scaleScalar<float>,
+                        subMulScalar<float>, argmaxScalar<float>,
+                        argminScalar<float>, minRatioScalar<float>};
+#ifdef SIMPLEX_X86
+    if (isa == AVX512) {
+        k.isa = "avx512";
+        k.scale = scaleAVX512;
+        k.subMul = subMulAVX512;
+    } else if (isa == AVX2) {
+        k.isa = "avx2";
+        k.scale = scaleAVX2;
+        k.subMul = subMulAVX2;
+    }
+#endif
+    return k;
+}
+
+// The kernels for this CPU, chosen on first use.
+template <class T = double> inline const Kernels<T> &get() {
+    static const Kernels<T> table = pick<T>(pickISA());
+    return table;
+}
+
+} // namespace kernels
+
+#endif
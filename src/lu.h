@@ -0,0 +1,375 @@
+// Sparse LU factorization of a simplex basis, with product-form updates.
+//
+// factor() eliminates the m x m basis with Markowitz pivoting (singleton
+// columns and rows first, then the pivot with the smallest (r-1)(c-1) among
+// entries within a threshold of their column's largest), storing L as row
+// etas and U row by row in pivot order.  Each basis change afterwards adds
+// one product-form eta; the engine refactorizes once there are too many.
+//
+// Vectors indexed "by row" follow the constraint rows; vectors indexed "by
+// position" follow the basis columns (the k-th basic variable).
+
+#ifndef LU_H
+#define LU_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class BasisFactor {
+  public:
+    typedef std::pair<int, double> Entry;
+
+    // Entries below this are treated as zero when choosing a pivot.
+    static constexpr double PIVOT_ZERO = 1e-11;
+    // Accept a pivot at least this fraction of its column's largest entry.
+    static constexpr double THRESHOLD = 0.01;
+
+    /*
+      Factorize the basis whose column at position k is cols[k] (entries are
+      (row, value)).  If it is singular, the positions that could not be
+      pivoted are paired with the rows left over: replaced gets one
+      (position, row) per pair, and the factorization is of the basis with
+      those columns replaced by the slack (unit) column of that row.
+    */
+    void factor(int m0, const std::vector<std::vector<Entry>> &cols,
+                std::vector<std::pair<int, int>> &replaced) {
+        m = m0;
+        lStart.assign(1, 0);
+        lPivot.clear();
+        lEntries.clear();
+        uStart.assign(1, 0);
+        uRow.clear();
+        uCol.clear();
+        uPivot.clear();
+        uEntries.clear();
+        clearEtas();
+        replaced.clear();
+
+        std::vector<std::vector<Entry>> col(cols);
+        std::vector<std::vector<int>> rowPat(m);
+        for (int j = 0; j < m; j++)
+            for (auto &e : col[j])
+                rowPat[e.first].push_back(j);
+
+        std::vector<char> colDone(m, 0), rowDone(m, 0);
+        std::vector<int> colQueue, rowQueue, where(m, -1);
+        for (int j = 0; j < m; j++)
+            if (col[j].size() == 1)
+                colQueue.push_back(j);
+        for (int i = 0; i < m; i++)
+            if (rowPat[i].size() == 1)
+                rowQueue.push_back(i);
+
+        std::vector<Entry> uRowTmp, lColTmp;
+        for (int step = 0; step < m; step++) {
+            int p = -1, q = -1;
+            if (!choose(col, rowPat, colDone, rowDone, colQueue, rowQueue, p,
+                        q))
+                break;
+
+            double piv = 0;
+            for (auto &e : col[q])
+                if (e.first == p)
+                    piv = e.second;
+
+            // Row p of the active matrix becomes U's row for this pivot.
+            uRowTmp.clear();
+            for (int j : rowPat[p]) {
+                if (j == q)
+                    continue;
+                auto &cj = col[j];
+                for (size_t k = 0; k < cj.size(); k++) {
+                    if (cj[k].first == p) {
+                        uRowTmp.emplace_back(j, cj[k].second);
+                        cj[k] = cj.back();
+                        cj.pop_back();
+                        break;
+                    }
+                }
+                if (cj.size() == 1)
+                    colQueue.push_back(j);
+            }
+
+            // Column q below the pivot becomes an L eta.
+            lColTmp.clear();
+            for (auto &e : col[q]) {
+                if (e.first == p)
+                    continue;
+                lColTmp.emplace_back(e.first, e.second / piv);
+                removeFrom(rowPat[e.first], q);
+            }
+            colDone[q] = rowDone[p] = 1;
+            col[q].clear();
+            rowPat[p].clear();
+
+            // Rank-1 update of the active submatrix, with fill-in.
+            for (auto &u : uRowTmp) {
+                auto &cj = col[u.first];
+                for (size_t k = 0; k < cj.size(); k++)
+                    where[cj[k].first] = k;
+                for (auto &l : lColTmp) {
+                    double v = -l.second * u.second;
+                    if (where[l.first] >= 0) {
+                        cj[where[l.first]].second += v;
+                    } else {
+                        where[l.first] = cj.size();
+                        cj.emplace_back(l.first, v);
+                        rowPat[l.first].push_back(u.first);
+                    }
+                }
+                for (auto &e : cj)
+                    where[e.first] = -1;
+                if (cj.size() == 1)
+                    colQueue.push_back(u.first);
+            }
+            for (auto &l : lColTmp)
+                if (rowPat[l.first].size() == 1)
+                    rowQueue.push_back(l.first);
+
+            if (!lColTmp.empty()) {
+                lPivot.push_back(p);
+                lEntries.insert(lEntries.end(), lColTmp.begin(),
+                                lColTmp.end());
+                lStart.push_back(lEntries.size());
+            }
+            uRow.push_back(p);
+            uCol.push_back(q);
+            uPivot.push_back(piv);
+            uEntries.insert(uEntries.end(), uRowTmp.begin(), uRowTmp.end());
+            uStart.push_back(uEntries.size());
+        }
+
+        // Singular basis: give each position that wasn't pivoted (choose()
+        // also gives up on numerically empty columns) a leftover row's
+        // slack.  L leaves rows that were never pivoted alone, so that slack
+        // column is still a unit vector, and nothing follows it in U.
+        std::vector<char> pivoted(m, 0);
+        for (int j : uCol)
+            pivoted[j] = 1;
+        int i = 0;
+        for (int j = 0; j < m; j++) {
+            if (pivoted[j])
+                continue;
+            while (rowDone[i])
+                i++;
+            rowDone[i] = 1;
+            replaced.emplace_back(j, i);
+        }
+        if (replaced.empty())
+            return;
+        // The pivot rows' U entries for a replaced position are the old
+        // column's; the slack has none there.
+        std::vector<Entry> kept;
+        std::vector<int> start(1, 0);
+        for (size_t k = 0; k + 1 < uStart.size(); k++) {
+            for (int e = uStart[k]; e < uStart[k + 1]; e++)
+                if (pivoted[uEntries[e].first])
+                    kept.push_back(uEntries[e]);
+            start.push_back(kept.size());
+        }
+        uEntries.swap(kept);
+        uStart.swap(start);
+        for (auto &pr : replaced) {
+            uRow.push_back(pr.second);
+            uCol.push_back(pr.first);
+            uPivot.push_back(1);
+            uStart.push_back(uEntries.size());
+        }
+    }
+
+    // Solve B x = a.  a is by row and is overwritten; x is by position.
+    void ftran(std::vector<double> &a, std::vector<double> &x) const {
+        x.assign(m, 0.0);
+        for (size_t k = 0; k < lPivot.size(); k++) {
+            double xp = a[lPivot[k]];
+            if (xp == 0)
+                continue;
+            for (int e = lStart[k]; e < lStart[k + 1]; e++)
+                a[lEntries[e].first] -= lEntries[e].second * xp;
+        }
+        for (int k = (int)uRow.size() - 1; k >= 0; k--) {
+            double v = a[uRow[k]];
+            for (int e = uStart[k]; e < uStart[k + 1]; e++)
+                v -= uEntries[e].second * x[uEntries[e].first];
+            x[uCol[k]] = v / uPivot[k];
+        }
+        for (size_t k = 0; k < etaPos.size(); k++) {
+            double xr = x[etaPos[k]];
+            if (xr == 0)
+                continue;
+            xr /= etaPivot[k];
+            x[etaPos[k]] = xr;
+            for (int e = etaStart[k]; e < etaStart[k + 1]; e++)
+                x[etaEntries[e].first] -= etaEntries[e].second * xr;
+        }
+    }
+
+    // Solve B^T y = c.  c is by position and is overwritten; y is by row.
+    void btran(std::vector<double> &c, std::vector<double> &y) const {
+        y.assign(m, 0.0);
+        for (int k = (int)etaPos.size() - 1; k >= 0; k--) {
+            double s = c[etaPos[k]];
+            for (int e = etaStart[k]; e < etaStart[k + 1]; e++)
+                s -= etaEntries[e].second * c[etaEntries[e].first];
+            c[etaPos[k]] = s / etaPivot[k];
+        }
+        for (size_t k = 0; k < uRow.size(); k++) {
+            double w = c[uCol[k]] / uPivot[k];
+            y[uRow[k]] = w;
+            if (w == 0)
+                continue;
+            for (int e = uStart[k]; e < uStart[k + 1]; e++)
+                c[uEntries[e].first] -= uEntries[e].second * w;
+        }
+        for (int k = (int)lPivot.size() - 1; k >= 0; k--) {
+            double s = 0;
+            for (int e = lStart[k]; e < lStart[k + 1]; e++)
+                s += lEntries[e].second * y[lEntries[e].first];
+            y[lPivot[k]] -= s;
+        }
+    }
+
+    // The basic variable at position r was replaced by one whose FTRAN'd
+    // column is alpha (by position).
+    void update(int r, const std::vector<double> &alpha) {
+        etaPos.push_back(r);
+        etaPivot.push_back(alpha[r]);
+        for (int i = 0; i < m; i++)
+            if (i != r && alpha[i] != 0)
+                etaEntries.emplace_back(i, alpha[i]);
+        etaStart.push_back(etaEntries.size());
+    }
+
+    int updates() const { return (int)etaPos.size(); }
+
+  private:
+    int m = 0;
+
+    // L: for eta k, subtract entry * a[lPivot[k]] from a[entry row].
+    std::vector<int> lStart, lPivot;
+    std::vector<Entry> lEntries;
+
+    // U, one row per pivot in elimination order; entries are (position, v).
+    std::vector<int> uStart, uRow, uCol;
+    std::vector<double> uPivot;
+    std::vector<Entry> uEntries;
+
+    // Product-form etas from update().
+    std::vector<int> etaStart{0}, etaPos;
+    std::vector<double> etaPivot;
+    std::vector<Entry> etaEntries;
+
+    void clearEtas() {
+        etaStart.assign(1, 0);
+        etaPos.clear();
+        etaPivot.clear();
+        etaEntries.clear();
+    }
+
+    static void removeFrom(std::vector<int> &v, int x) {
+        for (size_t k = 0; k < v.size(); k++) {
+            if (v[k] == x) {
+                v[k] = v.back();
+                v.pop_back();
+                return;
+            }
+        }
+    }
+
+    static double colMax(const std::vector<Entry> &c) {
+        double mx = 0;
+        for (auto &e : c)
+            mx = std::max(mx, std::fabs(e.second));
+        return mx;
+    }
+
+    bool choose(std::vector<std::vector<Entry>> &col,
+                const std::vector<std::vector<int>> &rowPat,
+                std::vector<char> &colDone, const std::vector<char> &rowDone,
+                std::vector<int> &colQueue, std::vector<int> &rowQueue,
+                int &p, int &q) {
+        // Column singletons: no fill and no L eta.
+        while (!colQueue.empty()) {
+            int j = colQueue.back();
+            colQueue.pop_back();
+            if (colDone[j] || col[j].size() != 1)
+                continue;
+            if (std::fabs(col[j][0].second) <= PIVOT_ZERO) {
+                // Numerically empty: leave it for the slack replacement.
+                colDone[j] = 1;
+                col[j].clear();
+                continue;
+            }
+            p = col[j][0].first;
+            q = j;
+            return true;
+        }
+
+        // Row singletons: no fill.
+        while (!rowQueue.empty()) {
+            int i = rowQueue.back();
+            rowQueue.pop_back();
+            if (rowDone[i] || rowPat[i].size() != 1)
+                continue;
+            int j = rowPat[i][0];
+            double mx = colMax(col[j]);
+            for (auto &e : col[j]) {
+                if (e.first == i && std::fabs(e.second) > PIVOT_ZERO &&
+                    std::fabs(e.second) >= THRESHOLD * mx) {
+                    p = i;
+                    q = j;
+                    return true;
+                }
+            }
+        }
+
+        // Markowitz: look at a few of the sparsest columns.  Numerically
+        // empty ones don't count; they are dropped and the search goes on
+        // to the next sparsest until a pivot turns up or none are left, so
+        // a run of them never leaves good columns to the slack replacement.
+        const int SEARCH = 4;
+        long bestCost = -1;
+        double bestVal = 0;
+        while (bestCost < 0) {
+            size_t minCount = SIZE_MAX;
+            for (size_t j = 0; j < col.size(); j++)
+                if (!colDone[j] && !col[j].empty() &&
+                    col[j].size() < minCount)
+                    minCount = col[j].size();
+            if (minCount == SIZE_MAX)
+                break;
+            for (size_t j = 0, seen = 0; j < col.size() && seen < SEARCH;
+                 j++) {
+                if (colDone[j] || col[j].size() != minCount)
+                    continue;
+                double mx = colMax(col[j]);
+                if (mx <= PIVOT_ZERO) {
+                    colDone[j] = 1;
+                    col[j].clear();
+                    continue;
+                }
+                seen++;
+                for (auto &e : col[j]) {
+                    double a = std::fabs(e.second);
+                    if (a < THRESHOLD * mx)
+                        continue;
+                    long cost = (long)(rowPat[e.first].size() - 1) *
+                                (long)(col[j].size() - 1);
+                    if (bestCost < 0 || cost < bestCost ||
+                        (cost == bestCost && a > bestVal)) {
+                        bestCost = cost;
+                        bestVal = a;
+                        p = e.first;
+                        q = j;
+                    }
+                }
+            }
+        }
+        return bestCost >= 0;
+    }
+};
+
+#endif
@@ -0,0 +1,637 @@
+// Streaming reader for netlib MPS (fixed or free format) models, and the
+// conversion of those models into the standard form our solvers take:
+//
+//   max c dot x s.t. a x <= b  x >= 0
+//
+// This replaces checker.py's parseInput, which went through pysmps and numpy
+// and then round-tripped the whole dense matrix through a text file.
+
+#ifndef MPS_H
+#define MPS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "emps.h"
+#include "sparse.h"
+
+// A linear program exactly as the MPS file describes it:
+//   min obj dot x + objConst  s.t.  row bounds on a x, lower <= x <= upper
+struct MPSModel {
+    std::string name;
+    std::string objName;
+
+    std::vector<std::string> rowNames; // constraint rows, objective excluded
+    std::vector<char> rowType;         // 'L', 'G' or 'E'
+    std::vector<double> rhs;
+    std::vector<double> range; // NAN when the row has no RANGES entry
+
+    std::vector<std::string> colNames;
+    std::vector<double> obj;
+    std::vector<std::vector<std::pair<int, double>>> cols; // (row, value)
+    std::vector<double> lower, upper;
+    double objConst = 0;
+
+    int numRows() const { return (int)rowNames.size(); }
+    int numCols() const { return (int)colNames.size(); }
+
+    // Interval [lo, up] that row i's activity has to lie in.
+    void rowBounds(int i, double &lo, double &up) const {
+        double b = rhs[i], r = range[i];
+        lo = -INFINITY;
+        up = INFINITY;
+        if (rowType[i] == 'L') {
+            up = b;
+            if (!std::isnan(r))
+                lo = b - std::fabs(r);
+        } else if (rowType[i] == 'G') {
+            lo = b;
+            if (!std::isnan(r))
+                up = b + std::fabs(r);
+        } else {
+            lo = up = b;
+            if (!std::isnan(r) && r > 0)
+                up = b + r;
+            else if (!std::isnan(r))
+                lo = b + r;
+        }
+    }
+
+    // The objective at x, objConst included.
+    double objective(const std::vector<double> &x) const {
+        double v = objConst;
+        for (int j = 0; j < numCols(); j++)
+            v += obj[j] * x[j];
+        return v;
+    }
+
+    // How far x is outside the rows' and columns' bounds at worst, each
+    // relative to 1 + |bound|: 0 if x is feasible.
+    double violation(const std::vector<double> &x) const {
+        double worst = 0;
+        auto check = [&](double v, double lo, double up) {
+            if (v < lo)
+                worst = std::max(worst, (lo - v) / (1 + std::fabs(lo)));
+            if (v > up)
+                worst = std::max(worst, (v - up) / (1 + std::fabs(up)));
+        };
+        std::vector<double> activity(numRows(), 0.0);
+        for (int j = 0; j < numCols(); j++) {
+            check(x[j], lower[j], upper[j]);
+            for (auto &e : cols[j])
+                activity[e.first] += e.second * x[j];
+        }
+        for (int i = 0; i < numRows(); i++) {
+            double lo, up;
+            rowBounds(i, lo, up);
+            check(activity[i], lo, up);
+        }
+        return worst;
+    }
+};
+
+// Push-based MPS parser: feed it one line at a time, so the same code reads
+// plain files and streams produced by other decoders.  Names are split on
+// whitespace (free MPS); a line whose field count does not fit is re-read
+// with the fixed MPS column positions, which allow blanks inside names.
+class MPSParser {
+  private:
+    enum Section { NONE, NAME, ROWS, COLUMNS, RHS, RANGES, BOUNDS, END };
+
+    MPSModel &model;
+    Section section;
+    long nline;
+    int curCol;
+    std::unordered_map<std::string, int> rowIndex; // objective row is -1
+    std::unordered_map<std::string, int> colIndex;
+
+  public:
+    std::string error;
+
+    MPSParser(MPSModel &model0)
+        : model(model0), section(NONE), nline(0), curCol(-1) {}
+
+    // Returns false (and sets error) on a malformed line.
+    bool line(const char *s) {
+        nline++;
+        if (section == END)
+            return true;
+        if (*s == '*' || *s == 0 || *s == '\n' || *s == '\r')
+            return true;
+
+        std::vector<std::string> tok;
+        split(s, tok);
+        if (tok.empty())
+            return true;
+
+        if (*s != ' ' && *s != '\t')
+            return header(tok);
+
+        switch (section) {
+        case ROWS:
+            return rowLine(tok);
+        case COLUMNS:
+            if (tok.size() != 3 && tok.size() != 5 && !isMarker(tok))
+                fixedFields(s, tok);
+            return columnLine(tok);
+        case RHS:
+        case RANGES:
+            if (tok.size() % 2 == 1 && tok.size() != 3 && tok.size() != 5)
+                fixedFields(s, tok);
+            return rhsLine(tok);
+        case BOUNDS:
+            if (tok.size() < 3 || tok.size() > 4)
+                fixedFields(s, tok);
+            return boundLine(tok);
+        default:
+            return fail("data line outside of a section");
+        }
+    }
+
+    // Call once the input is exhausted.
+    bool finish() {
+        if (section == NONE)
+            return fail("no NAME section");
+        if (model.objName.empty())
+            return fail("no objective (N) row");
+        return true;
+    }
+
+  private:
+    bool fail(const std::string &msg) {
+        error = msg + ": line " + std::to_string(nline);
+        return false;
+    }
+
+    static void split(const char *s, std::vector<std::string> &tok) {
+        while (*s) {
+            while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r')
+                s++;
+            if (!*s)
+                break;
+            const char *t = s;
+            while (*s && *s != ' ' && *s != '\t' && *s != '\n' && *s != '\r')
+                s++;
+            tok.emplace_back(t, s - t);
+        }
+    }
+
+    // Fixed MPS: fields start at columns 2, 5, 15, 25, 40 and 50.
+    static void fixedFields(const char *s, std::vector<std::string> &tok) {
+        static const int start[] = {1, 4, 14, 24, 39, 49};
+        static const int width[] = {2, 8, 8, 12, 8, 12};
+        size_t len = strcspn(s, "\r\n");
+        tok.clear();
+        for (int f = 0; f < 6; f++) {
+            if ((size_t)start[f] >= len)
+                break;
+            std::string field(s + start[f],
+                              std::min<size_t>(width[f], len - start[f]));
+            size_t b = field.find_first_not_of(' ');
+            size_t e = field.find_last_not_of(' ');
+            field = b == std::string::npos ? "" : field.substr(b, e - b + 1);
+            if (f == 0) { // the type field may be empty
+                if (!field.empty())
+                    tok.push_back(field);
+            } else if (!field.empty() || f < 3) {
+                tok.push_back(field);
+            }
+        }
+    }
+
+    static bool isMarker(const std::vector<std::string> &tok) {
+        return tok.size() >= 3 && tok[1] == "'MARKER'";
+    }
+
+    bool number(const std::string &s, double &v) {
+        char *end;
+        v = strtod(s.c_str(), &end);
+        if (end == s.c_str() || *end)
+            return fail("bad number \"" + s + "\"");
+        return true;
+    }
+
+    bool header(const std::vector<std::string> &tok) {
+        const std::string &h = tok[0];
+        if (h == "NAME") {
+            section = NAME;
+            if (tok.size() > 1)
+                model.name = tok[1];
+        } else if (h == "ROWS") {
+            section = ROWS;
+        } else if (h == "COLUMNS") {
+            section = COLUMNS;
+        } else if (h == "RHS") {
+            section = RHS;
+        } else if (h == "RANGES") {
+            section = RANGES;
+        } else if (h == "BOUNDS") {
+            section = BOUNDS;
+        } else if (h == "ENDATA") {
+            section = END;
+        } else {
+            return fail("unknown section " + h);
+        }
+        return true;
+    }
+
+    bool rowLine(const std::vector<std::string> &tok) {
+        if (tok.size() < 2)
+            return fail("bad ROWS line");
+        char type = tok[0][0];
+        if (type == 'N') {
+            // Only the first free row is the objective; drop the others.
+            if (model.objName.empty()) {
+                model.objName = tok[1];
+                rowIndex[tok[1]] = -1;
+            } else {
+                rowIndex[tok[1]] = -2;
+            }
+            return true;
+        }
+        if (type != 'L' && type != 'G' && type != 'E')
+            return fail("bad row type " + tok[0]);
+        rowIndex[tok[1]] = model.numRows();
+        model.rowNames.push_back(tok[1]);
+        model.rowType.push_back(type);
+        model.rhs.push_back(0);
+        model.range.push_back(NAN);
+        return true;
+    }
+
+    int findRow(const std::string &name) {
+        auto it = rowIndex.find(name);
+        return it == rowIndex.end() ? -3 : it->second;
+    }
+
+    bool columnLine(const std::vector<std::string> &tok) {
+        if (isMarker(tok))
+            return true; // integer markers: we solve the LP relaxation
+        if (tok.size() != 3 && tok.size() != 5)
+            return fail("bad COLUMNS line");
+
+        if (curCol < 0 || model.colNames[curCol] != tok[0]) {
+            auto it = colIndex.find(tok[0]);
+            if (it != colIndex.end()) {
+                curCol = it->second;
+            } else {
+                curCol = model.numCols();
+                colIndex[tok[0]] = curCol;
+                model.colNames.push_back(tok[0]);
+                model.obj.push_back(0);
+                model.cols.emplace_back();
+                model.lower.push_back(0);
+                model.upper.push_back(INFINITY);
+            }
+        }
+        for (size_t f = 1; f + 1 < tok.size(); f += 2) {
+            double v;
+            if (!number(tok[f + 1], v))
+                return false;
+            int r = findRow(tok[f]);
+            if (r == -3)
+                return fail("unknown row " + tok[f]);
+            if (r == -1)
+                model.obj[curCol] += v;
+            else if (r >= 0 && v != 0)
+                model.cols[curCol].emplace_back(r, v);
+        }
+        return true;
+    }
+
+    // RHS and RANGES share a layout; the set name is optional in free MPS.
+    bool rhsLine(const std::vector<std::string> &tok) {
+        size_t f = tok.size() % 2 == 1 ? 1 : 0;
+        if (tok.size() < 2)
+            return fail("bad " + std::string(section == RHS ? "RHS" : "RANGES") +
+                        " line");
+        for (; f + 1 < tok.size(); f += 2) {
+            double v;
+            if (!number(tok[f + 1], v))
+                return false;
+            int r = findRow(tok[f]);
+            if (r == -3)
+                return fail("unknown row " + tok[f]);
+            if (r == -1 && section == RHS)
+                model.objConst = -v;
+            else if (r >= 0 && section == RHS)
+                model.rhs[r] = v;
+            else if (r >= 0)
+                model.range[r] = v;
+        }
+        return true;
+    }
+
+    bool boundLine(const std::vector<std::string> &tok) {
+        // type [set] column [value]; FR, MI, PL and BV take no value
+        const std::string &type = tok[0];
+        bool noValue = type == "FR" || type == "MI" || type == "PL" ||
+                       type == "BV";
+        size_t colField;
+        if (noValue)
+            colField = tok.size() >= 3 ? 2 : 1;
+        else
+            colField = tok.size() >= 4 ? 2 : 1;
+        if (colField >= tok.size())
+            return fail("bad BOUNDS line");
+
+        auto it = colIndex.find(tok[colField]);
+        if (it == colIndex.end())
+            return fail("unknown column " + tok[colField]);
+        int j = it->second;
+
+        double v = 0;
+        if (!noValue) {
+            if (colField + 1 >= tok.size())
+                return fail("missing bound value");
+            if (!number(tok[colField + 1], v))
+                return false;
+        }
+
+        if (type == "UP" || type == "UI") {
+            model.upper[j] = v;
+            // Old MPS convention: a negative upper bound on a variable
+            // with the default lower bound makes it unbounded below.
+            if (v < 0 && model.lower[j] == 0)
+                model.lower[j] = -INFINITY;
+        } else if (type == "LO" || type == "LI") {
+            model.lower[j] = v;
+        } else if (type == "FX") {
+            model.lower[j] = model.upper[j] = v;
+        } else if (type == "FR") {
+            model.lower[j] = -INFINITY;
+            model.upper[j] = INFINITY;
+        } else if (type == "MI") {
+            model.lower[j] = -INFINITY;
+        } else if (type == "PL") {
+            model.upper[j] = INFINITY;
+        } else if (type == "BV") {
+            model.lower[j] = 0;
+            model.upper[j] = 1;
+        } else {
+            return fail("bad bound type " + type);
+        }
+        return true;
+    }
+};
+
+// Read an MPS file, or a netlib compressed one if the name ends in ".mpsc".
+// Prints a diagnostic and returns false on failure.
+inline bool loadMPS(const char *path, MPSModel &model) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "can't open " << path << std::endl;
+        return false;
+    }
+    MPSParser parser(model);
+    size_t len = strlen(path);
+    if (len > 5 && !strcmp(path + len - 5, ".mpsc")) {
+        MPSCDecoder decoder(in);
+        if (!decoder.decode([&](const char *s) { return parser.line(s); })) {
+            std::cerr << path << ": "
+                      << (parser.error.empty() ? decoder.error : parser.error)
+                      << std::endl;
+            return false;
+        }
+    } else {
+        std::string buf;
+        while (std::getline(in, buf)) {
+            if (!parser.line(buf.c_str())) {
+                std::cerr << path << ": " << parser.error << std::endl;
+                return false;
+            }
+        }
+    }
+    if (!parser.finish()) {
+        std::cerr << path << ": " << parser.error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Bounds a solver takes natively instead of as extra rows and columns:
+// lower[j] <= x_j <= upper[j], and 0 <= b_i - a_i x <= range[i] for the
+// slack of row i.  Empty when the model has none.
+struct Bounds {
+    std::vector<double> lower, upper, range;
+};
+
+/*
+  The model rewritten for our Simplex solvers:
+    max c dot x s.t. a x <= b  x >= 0,  a = mxn (dense)
+  Each model column j becomes
+    x_j = shift[j] + x'_pos[j] - x'_neg[j]
+  (pos/neg are -1 when that part is absent), so lower bounds are shifted
+  to zero instead of costing a row, G rows are negated, and E and ranged
+  rows become a pair of <= rows.
+
+  The bounded form (toStandardForm(model, sf, true)) keeps the model's own
+  m and n instead, for solvers that handle bounds themselves: each row is
+  one <= row whose slack is at most its range (0 for an E row), upper
+  bounds go in bounds.upper rather than rows, and a free column stays one
+  column with bounds.lower = -INFINITY (otherwise 0, after the shift).
+*/
+struct StandardForm {
+    int m = 0, n = 0;
+    SparseMatrix A;
+    std::vector<double> B, C;
+    Bounds bounds; // the bounded form only
+
+    std::vector<int> pos, neg;
+    std::vector<double> shift;
+    double objConst = 0;
+
+    // Where the model's rows went, for basis files (basis.h): the rows of
+    // each one's upper and lower side (-1 if it has none, and in the
+    // bounded form a row with both has only its upper one), and the row
+    // capping each column x'_j at its upper bound (-1 if none, and always
+    // in the bounded form).
+    std::string name;
+    std::vector<std::string> rowNames, colNames;
+    std::vector<int> upperRow, lowerRow, capRow;
+
+    // The model's (minimized) objective, given the Simplex maximum z.
+    double objective(double z) const { return objConst - z; }
+
+    // Model variable values, given the Simplex solution.
+    std::vector<double> solution(const std::vector<double> &soln) const {
+        std::vector<double> x(shift);
+        for (size_t j = 0; j < x.size(); j++) {
+            if (pos[j] >= 0)
+                x[j] += soln[pos[j]];
+            if (neg[j] >= 0)
+                x[j] -= soln[neg[j]];
+        }
+        return x;
+    }
+};
+
+inline void toStandardForm(const MPSModel &model, StandardForm &sf,
+                           bool bounded = false) {
+    int mr = model.numRows(), nc = model.numCols();
+
+    // Columns first: shifting lower bounds moves some of b.
+    std::vector<double> rowShift(mr, 0.0);
+    sf.pos.assign(nc, -1);
+    sf.neg.assign(nc, -1);
+    sf.shift.assign(nc, 0.0);
+    sf.objConst = model.objConst;
+    std::vector<double> cap, low; // bounds on x' for each pos part
+    int n = 0;
+    for (int j = 0; j < nc; j++) {
+        double lo = model.lower[j], up = model.upper[j];
+        if (std::isfinite(lo)) {
+            sf.shift[j] = lo;
+            sf.pos[j] = n++;
+            cap.push_back(up - lo);
+            low.push_back(0);
+        } else if (std::isfinite(up)) {
+            // x = up - x', x' >= 0
+            sf.shift[j] = up;
+            sf.neg[j] = n++;
+            cap.push_back(INFINITY);
+            low.push_back(0);
+        } else if (bounded) {
+            sf.pos[j] = n++;
+            cap.push_back(INFINITY);
+            low.push_back(-INFINITY);
+        } else {
+            sf.pos[j] = n++;
+            sf.neg[j] = n++;
+            cap.insert(cap.end(), 2, INFINITY);
+            low.insert(low.end(), 2, 0.0);
+        }
+        if (sf.shift[j] != 0) {
+            for (auto &e : model.cols[j])
+                rowShift[e.first] += e.second * sf.shift[j];
+            sf.objConst += model.obj[j] * sf.shift[j];
+        }
+    }
+
+    // Rows: one <= row per finite side of each constraint, or in the
+    // bounded form one per constraint, on its upper side if it has one.
+    std::vector<std::pair<int, double>> rows; // (model row, sign)
+    std::vector<double> b, range;
+    for (int i = 0; i < mr; i++) {
+        double lo, up;
+        model.rowBounds(i, lo, up);
+        if (std::isfinite(up)) {
+            rows.emplace_back(i, 1.0);
+            b.push_back(up - rowShift[i]);
+            range.push_back(up - lo);
+        }
+        if (std::isfinite(lo) && !(bounded && std::isfinite(up))) {
+            rows.emplace_back(i, -1.0);
+            b.push_back(rowShift[i] - lo);
+            range.push_back(INFINITY);
+        }
+    }
+    std::vector<int> firstRow(mr, -1), secondRow(mr, -1);
+    sf.upperRow.assign(mr, -1);
+    sf.lowerRow.assign(mr, -1);
+    for (size_t k = 0; k < rows.size(); k++) {
+        int i = rows[k].first;
+        if (firstRow[i] < 0)
+            firstRow[i] = k;
+        else
+            secondRow[i] = k;
+        (rows[k].second > 0 ? sf.upperRow : sf.lowerRow)[i] = k;
+    }
+    sf.name = model.name;
+    sf.rowNames = model.rowNames;
+    sf.colNames = model.colNames;
+    int m = rows.size();
+    for (int j = 0; j < n && !bounded; j++)
+        if (std::isfinite(cap[j]))
+            m++;
+
+    sf.m = m;
+    sf.n = n;
+    sf.B.assign(m, 0.0);
+    sf.C.assign(n, 0.0);
+    for (size_t k = 0; k < rows.size(); k++)
+        sf.B[k] = b[k];
+    if (bounded) {
+        sf.bounds.lower = low;
+        sf.bounds.upper = cap;
+        sf.bounds.range = range;
+    }
+
+    // Straight from the model's columns into sparse storage; A is never
+    // dense here.
+    std::vector<Triplet> t;
+    for (int j = 0; j < nc; j++) {
+        // We maximize, the model minimizes.
+        if (sf.pos[j] >= 0)
+            sf.C[sf.pos[j]] = -model.obj[j];
+        if (sf.neg[j] >= 0)
+            sf.C[sf.neg[j]] = model.obj[j];
+        for (auto &e : model.cols[j]) {
+            for (int k : {firstRow[e.first], secondRow[e.first]}) {
+                if (k < 0)
+                    continue;
+                double v = rows[k].second * e.second;
+                if (sf.pos[j] >= 0)
+                    t.push_back({k, sf.pos[j], v});
+                if (sf.neg[j] >= 0)
+                    t.push_back({k, sf.neg[j], -v});
+            }
+        }
+    }
+
+    int k = rows.size();
+    sf.capRow.assign(n, -1);
+    for (int j = 0; j < n && !bounded; j++) {
+        if (std::isfinite(cap[j])) {
+            t.push_back({k, j, 1.0});
+            sf.capRow[j] = k;
+            sf.B[k++] = cap[j];
+        }
+    }
+    sf.A = SparseMatrix::fromTriplets(m, n, std::move(t));
+}
+
+// For a problem that comes in standard form (max c dot x, a x <= b,
+// x >= 0) with no model behind it: sf's model is the problem itself, with
+// columns named X<j> and rows R<i>.
+inline void plainStandardForm(int m, int n, StandardForm &sf) {
+    sf.m = m;
+    sf.n = n;
+    sf.pos.resize(n);
+    sf.neg.assign(n, -1);
+    sf.shift.assign(n, 0.0);
+    sf.capRow.assign(n, -1);
+    sf.colNames.resize(n);
+    for (int j = 0; j < n; j++) {
+        sf.pos[j] = j;
+        sf.colNames[j] = "X" + std::to_string(j);
+    }
+    sf.upperRow.resize(m);
+    sf.lowerRow.assign(m, -1);
+    sf.rowNames.resize(m);
+    for (int i = 0; i < m; i++) {
+        sf.upperRow[i] = i;
+        sf.rowNames[i] = "R" + std::to_string(i);
+    }
+    sf.name = "random";
+}
+
+// Read an MPS file straight into standard form.
+inline bool loadStandardForm(const char *path, StandardForm &sf) {
+    MPSModel model;
+    if (!loadMPS(path, model))
+        return false;
+    toStandardForm(model, sf);
+    return true;
+}
+
+#endif
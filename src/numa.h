@@ -0,0 +1,192 @@
+// NUMA placement for the tableau Simplex: where its threads run and where
+// the tableau's pages live.
+//
+// Linux puts a page on the node of the thread that first touches it.  A
+// tableau zeroed (or filled) by main alone ends up on main's node, and on a
+// two-socket machine half the team then streams its rows in Pivot from the
+// other socket.  place() allocates the tableau untouched and has each
+// thread of the team zero the block of rows Pivot's TileQueue makes its
+// own (steal.h), so those pages start on its node.  Whatever fills the
+// rows afterwards leaves them there.
+//
+// That only holds if threads stay on their CPUs, so pin() binds thread t of
+// the team to one CPU: the CPUs this process may use, ordered by node and
+// then number, are dealt out to the threads in contiguous runs, so
+// neighbouring threads (which own neighbouring row blocks and steal from
+// each other first) share a node, and a team smaller than the machine
+// still spreads over every node's memory.  If OMP_PROC_BIND is set the
+// runtime binds them instead.
+//
+// report() prints each thread's CPU and node and how the tableau's pages
+// are spread over the nodes.  SIMPLEX_NUMA=off turns pinning and placement
+// off.
+
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <omp.h>
+
+#include "steal.h"
+#include "tableau.h"
+
+namespace numa {
+
+inline bool enabled() {
+    const char *env = getenv("SIMPLEX_NUMA");
+    return !(env && strcmp(env, "off") == 0);
+}
+
+// The node cpu belongs to, from sysfs, or 0 if that doesn't say.
+inline int cpuNode(int cpu) {
+    char path[64];
+    snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (!dir)
+        return 0;
+    int node = 0;
+    while (dirent *e = readdir(dir))
+        if (strncmp(e->d_name, "node", 4) == 0 && isdigit(e->d_name[4])) {
+            node = atoi(e->d_name + 4);
+            break;
+        }
+    closedir(dir);
+    return node;
+}
+
+// Did pin() bind the threads, or the runtime (OMP_PROC_BIND)?
+enum Binding { UNBOUND, PINNED, RUNTIME };
+
+inline Binding &binding() {
+    static Binding b = UNBOUND;
+    return b;
+}
+
+// Bind the team's threads as described above.  Call once, from outside a
+// parallel region, before the tableau is allocated.
+inline void pin() {
+    if (omp_get_proc_bind() != omp_proc_bind_false) {
+        binding() = RUNTIME;
+        return;
+    }
+    if (!enabled())
+        return;
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof allowed, &allowed))
+        return;
+    std::vector<std::pair<int, int>> cpus; // (node, cpu)
+    for (int c = 0; c < CPU_SETSIZE; c++)
+        if (CPU_ISSET(c, &allowed))
+            cpus.emplace_back(cpuNode(c), c);
+    if (cpus.empty())
+        return;
+    std::sort(cpus.begin(), cpus.end());
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        int count = cpus.size();
+        int k = nt <= count ? (int)((long)t * count / nt) : t % count;
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpus[k].second, &one);
+        sched_setaffinity(0, sizeof one, &one);
+    }
+    binding() = PINNED;
+}
+
+// Make A a rows x cols tableau whose blocks of blockRows rows are zeroed
+// by the thread whose share of the blocks TileQueue makes them, or zeroed
+// by the caller with SIMPLEX_NUMA=off.  Rows have room for one more column,
+// Phase1's x0, so its resizeCols doesn't copy them to the caller's node.
+template <class T>
+void place(BasicTableau<T> &A, int rows, int cols, int blockRows) {
+    if (!enabled()) {
+        A = BasicTableau<T>(rows, cols);
+        return;
+    }
+    A = BasicTableau<T>(rows, cols + 1, false);
+    A.resizeCols(cols);
+    int blocks = (rows + blockRows - 1) / blockRows;
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        int i0 = std::min(rows, TileQueue::first(blocks, nt, t) * blockRows);
+        int i1 =
+            std::min(rows, TileQueue::first(blocks, nt, t + 1) * blockRows);
+        if (i1 > i0)
+            memset(A[i0], 0, (size_t)(i1 - i0) * A.stride() * sizeof(T));
+    }
+}
+
+// Pages of A on each node, for up to SAMPLE pages spread over it, as
+// move_pages reports them; empty if it can't (no NUMA support).
+const int SAMPLE = 4096;
+
+template <class T> std::map<int, long> pageNodes(BasicTableau<T> &A) {
+    std::map<int, long> count;
+    long page = sysconf(_SC_PAGESIZE);
+    size_t bytes = (size_t)A.rows() * A.stride() * sizeof(T);
+    if (bytes == 0 || page <= 0)
+        return count;
+    char *begin = (char *)A.data();
+    long pages = (long)((bytes + page - 1) / page);
+    long step = std::max(1L, pages / SAMPLE);
+    std::vector<void *> at;
+    for (long p = 0; p < pages; p += step)
+        at.push_back(begin + p * page);
+    std::vector<int> status(at.size());
+    if (syscall(SYS_move_pages, 0, (unsigned long)at.size(), at.data(),
+                nullptr, status.data(), 0) != 0)
+        return std::map<int, long>();
+    for (int s : status)
+        if (s >= 0)
+            count[s]++;
+    return count;
+}
+
+// One line: how the threads are bound, each one's CPU and node, and where
+// A's pages are.
+template <class T> void report(BasicTableau<T> &A) {
+    int nt = omp_get_max_threads();
+    std::vector<int> cpu(nt, -1);
+    #pragma omp parallel
+    cpu[omp_get_thread_num()] = sched_getcpu();
+
+    static const char *how[] = {"unpinned", "pinned", "bound by OMP_PROC_BIND"};
+    std::cout << "Placement: " << nt << " threads " << how[binding()]
+              << ", on CPUs";
+    for (int c : cpu)
+        std::cout << " " << c;
+    std::cout << " (nodes";
+    for (int c : cpu)
+        std::cout << " " << (c >= 0 ? cpuNode(c) : -1);
+    std::cout << "); tableau pages";
+    std::map<int, long> pages = pageNodes(A);
+    long total = 0;
+    for (auto &p : pages)
+        total += p.second;
+    if (total == 0)
+        std::cout << " unknown";
+    for (auto &p : pages)
+        std::cout << " node " << p.first << " " << 100 * p.second / total
+                  << "%";
+    std::cout << (enabled() ? ", placed by row block" : ", not placed")
+              << std::endl;
+}
+
+} // namespace numa
+
+#endif
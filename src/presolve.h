@@ -0,0 +1,385 @@
+// Presolve: reductions on an MPSModel before it goes to standard form, so
+// the tableau the solver builds is smaller, and postsolve, which takes a
+// solution of the reduced model back to the original one.
+//
+//   empty rows         checked against their bounds and dropped
+//   empty columns      fixed at the bound the objective prefers
+//   fixed columns      l == u: moved into the row bounds and objConst
+//   singleton rows     become bounds on their one column
+//   singleton columns  an implied free one in an equality row is solved
+//                      for and substituted out with its row; a zero-cost
+//                      one elsewhere just widens its row's bounds
+//   redundant rows     the row's activity can't leave its bounds
+//   dominated columns  moving x_j toward one bound never hurts a row or
+//                      the objective: fixed at that bound
+//
+// The passes repeat until none applies.  If one finds the model infeasible
+// or unbounded, run() leaves the model alone and returns false, and the
+// solver finds that out for itself.
+
+#ifndef PRESOLVE_H
+#define PRESOLVE_H
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "mps.h"
+
+class Presolve {
+  public:
+    int rowsBefore = 0, colsBefore = 0, rowsAfter = 0, colsAfter = 0;
+    bool reduced = false; // run() returned true
+
+    // Reduce model in place.  False (and model untouched) if the model
+    // turned out infeasible or unbounded.
+    bool run(MPSModel &model) {
+        reduced = false;
+        load(model);
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int i = 0; i < (int)rowLo.size(); i++) {
+                if (!rowLive[i])
+                    continue;
+                int r = reduceRow(i);
+                if (r < 0)
+                    return false;
+                changed |= r > 0;
+            }
+            for (int j = 0; j < (int)colLo.size(); j++) {
+                if (!colLive[j])
+                    continue;
+                int r = reduceCol(j);
+                if (r < 0)
+                    return false;
+                changed |= r > 0;
+            }
+        }
+        store(model);
+        reduced = true;
+        return true;
+    }
+
+    // The original model's x, given x for the reduced model's columns.
+    // Without a reduction (run() not called, or false) they are the same.
+    std::vector<double> postsolve(const std::vector<double> &solved) const {
+        if (!reduced)
+            return solved;
+        std::vector<double> x(colLo.size(), 0.0);
+        for (size_t k = 0; k < kept.size(); k++)
+            x[kept[k]] = solved[k];
+        for (auto s = steps.rbegin(); s != steps.rend(); s++) {
+            double rest = 0;
+            for (auto &e : s->row)
+                rest += e.second * x[e.first];
+            if (s->kind == Step::FIX) {
+                x[s->col] = s->value;
+            } else if (s->kind == Step::SOLVE) {
+                x[s->col] = (s->lo - rest) / s->value;
+            } else {
+                // Any x_j in [l, u] that puts the row in [lo, up]; the one
+                // nearest 0.
+                double a = s->value, t1 = (s->lo - rest) / a,
+                       t2 = (s->up - rest) / a;
+                double lo = std::max(s->l, std::min(t1, t2)),
+                       up = std::min(s->u, std::max(t1, t2));
+                x[s->col] = std::min(std::max(0.0, lo), up);
+            }
+        }
+        return x;
+    }
+
+  private:
+    typedef std::pair<int, double> Entry; // (row or column, value)
+
+    const double TOL = 1e-9;
+
+    // The model as bounds on rows and columns, shrinking as reductions
+    // remove them.
+    std::vector<double> rowLo, rowUp, colLo, colUp, cost;
+    std::vector<std::vector<Entry>> rows, cols;
+    std::vector<char> rowLive, colLive;
+    std::vector<int> rowCount, colCount; // live entries
+    double objConst = 0;
+
+    // Postsolve, in the order done.  FIX: x_col = value.  SOLVE: x_col =
+    // (lo - row x) / value.  SLACK: x_col in [l, u] with value x_col +
+    // row x in [lo, up].  row holds the other columns' entries.
+    struct Step {
+        enum Kind { FIX, SOLVE, SLACK } kind;
+        int col;
+        double value;
+        std::vector<Entry> row;
+        double lo, up, l, u;
+    };
+    std::vector<Step> steps;
+    std::vector<int> kept; // reduced column -> original column
+
+    void load(const MPSModel &model) {
+        int m = model.numRows(), n = model.numCols();
+        rowsBefore = m;
+        colsBefore = n;
+        rowLo.resize(m);
+        rowUp.resize(m);
+        for (int i = 0; i < m; i++)
+            model.rowBounds(i, rowLo[i], rowUp[i]);
+        colLo = model.lower;
+        colUp = model.upper;
+        cost = model.obj;
+        objConst = model.objConst;
+        rows.assign(m, {});
+        cols.assign(n, {});
+        for (int j = 0; j < n; j++) {
+            // A row listed twice in a column counts once, summed.
+            std::vector<Entry> col = model.cols[j];
+            std::sort(col.begin(), col.end());
+            for (auto &e : col) {
+                if (!cols[j].empty() && cols[j].back().first == e.first)
+                    cols[j].back().second += e.second;
+                else
+                    cols[j].push_back(e);
+            }
+            col.clear();
+            for (auto &e : cols[j])
+                if (e.second != 0)
+                    col.push_back(e);
+            cols[j] = col;
+            for (auto &e : cols[j])
+                rows[e.first].emplace_back(j, e.second);
+        }
+        rowLive.assign(m, 1);
+        colLive.assign(n, 1);
+        rowCount.resize(m);
+        colCount.resize(n);
+        for (int i = 0; i < m; i++)
+            rowCount[i] = rows[i].size();
+        for (int j = 0; j < n; j++)
+            colCount[j] = cols[j].size();
+        steps.clear();
+    }
+
+    // |x| for scaling tolerances, 0 for an infinite bound.
+    static double size(double x) { return std::isfinite(x) ? std::fabs(x) : 0; }
+
+    void removeRow(int i) {
+        rowLive[i] = 0;
+        for (auto &e : rows[i])
+            colCount[e.first]--;
+    }
+
+    // Row i's live entries, except column skip.
+    std::vector<Entry> liveRow(int i, int skip) const {
+        std::vector<Entry> r;
+        for (auto &e : rows[i])
+            if (colLive[e.first] && e.first != skip)
+                r.push_back(e);
+        return r;
+    }
+
+    // Fix x_j = v: out of the rows and into objConst.
+    void fix(int j, double v) {
+        colLive[j] = 0;
+        for (auto &e : cols[j]) {
+            if (!rowLive[e.first])
+                continue;
+            rowLo[e.first] -= e.second * v;
+            rowUp[e.first] -= e.second * v;
+            rowCount[e.first]--;
+        }
+        objConst += cost[j] * v;
+        steps.push_back({Step::FIX, j, v, {}, 0, 0, 0, 0});
+    }
+
+    // Smallest and largest a x over the row's live columns but skip,
+    // within their bounds.
+    void activity(int i, int skip, double &lo, double &up) const {
+        lo = up = 0;
+        for (auto &e : rows[i]) {
+            int j = e.first;
+            if (!colLive[j] || j == skip)
+                continue;
+            double a = e.second;
+            lo += a > 0 ? a * colLo[j] : a * colUp[j];
+            up += a > 0 ? a * colUp[j] : a * colLo[j];
+        }
+    }
+
+    // 1 if row i was reduced, 0 if not, -1 if it proves the model
+    // infeasible.
+    int reduceRow(int i) {
+        if (rowCount[i] == 0) {
+            if (rowLo[i] > TOL || rowUp[i] < -TOL)
+                return -1;
+            removeRow(i);
+            return 1;
+        }
+        if (rowCount[i] == 1) {
+            Entry e = liveRow(i, -1)[0];
+            int j = e.first;
+            double a = e.second, lo = rowLo[i] / a, up = rowUp[i] / a;
+            if (a < 0)
+                std::swap(lo, up);
+            colLo[j] = std::max(colLo[j], lo);
+            colUp[j] = std::min(colUp[j], up);
+            if (colLo[j] > colUp[j] + TOL * (1 + size(colUp[j])))
+                return -1;
+            if (colLo[j] > colUp[j])
+                colUp[j] = colLo[j];
+            removeRow(i);
+            return 1;
+        }
+        double lo, up;
+        activity(i, -1, lo, up);
+        double tol = TOL * (1 + size(rowLo[i]) + size(rowUp[i]));
+        if (lo > rowUp[i] + tol || up < rowLo[i] - tol)
+            return -1;
+        if (lo >= rowLo[i] - tol && up <= rowUp[i] + tol) {
+            removeRow(i);
+            return 1;
+        }
+        return 0;
+    }
+
+    // 1 if column j was reduced, 0 if not, -1 if it proves the model
+    // unbounded.
+    int reduceCol(int j) {
+        double l = colLo[j], u = colUp[j], c = cost[j];
+        if (l == u) {
+            fix(j, l);
+            return 1;
+        }
+        if (colCount[j] == 0) {
+            if ((c > 0 && !std::isfinite(l)) || (c < 0 && !std::isfinite(u)))
+                return -1;
+            fix(j, c > 0 || (c == 0 && std::isfinite(l))
+                       ? l
+                       : std::isfinite(u) ? u : 0);
+            return 1;
+        }
+
+        // Dominated: lowering x_j loosens every row it is in and doesn't
+        // cost more (or raising it, the other way round).
+        bool down = c >= 0, up = c <= 0;
+        for (auto &e : cols[j]) {
+            if (!rowLive[e.first])
+                continue;
+            bool hasLo = std::isfinite(rowLo[e.first]),
+                 hasUp = std::isfinite(rowUp[e.first]);
+            down &= e.second > 0 ? !hasLo : !hasUp;
+            up &= e.second > 0 ? !hasUp : !hasLo;
+        }
+        if (down && std::isfinite(l)) {
+            fix(j, l);
+            return 1;
+        }
+        if (up && std::isfinite(u)) {
+            fix(j, u);
+            return 1;
+        }
+        if ((down && c > 0) || (up && c < 0))
+            return -1;
+
+        if (colCount[j] == 1) {
+            int i = -1;
+            double a = 0;
+            for (auto &e : cols[j]) {
+                if (rowLive[e.first]) {
+                    i = e.first;
+                    a = e.second;
+                }
+            }
+            return singletonColumn(j, i, a);
+        }
+        return 0;
+    }
+
+    // Column j's one live entry is a in row i.
+    int singletonColumn(int j, int i, double a) {
+        double l = colLo[j], u = colUp[j], c = cost[j];
+        double restLo, restUp;
+        activity(i, j, restLo, restUp);
+        if (rowLo[i] == rowUp[i]) {
+            // x_j = (b - rest) / a.  If the other columns' bounds already
+            // keep that within [l, u], x_j is as good as free: substitute
+            // it into the objective, and drop it and the row.
+            double b = rowLo[i], lo = (b - restUp) / a, up = (b - restLo) / a;
+            if (a < 0)
+                std::swap(lo, up);
+            if (lo >= l - TOL * (1 + size(l)) &&
+                up <= u + TOL * (1 + size(u))) {
+                std::vector<Entry> rest = liveRow(i, j);
+                for (auto &e : rest)
+                    cost[e.first] -= c * e.second / a;
+                objConst += c * b / a;
+                steps.push_back({Step::SOLVE, j, a, rest, b, b, l, u});
+                colLive[j] = 0;
+                removeRow(i);
+                return 1;
+            }
+        }
+        if (c == 0) {
+            // A free slack for row i: the rest of the row only has to be
+            // within [lo - max a x_j, up - min a x_j].
+            double axLo = a > 0 ? a * l : a * u, axUp = a > 0 ? a * u : a * l;
+            steps.push_back(
+                {Step::SLACK, j, a, liveRow(i, j), rowLo[i], rowUp[i], l, u});
+            rowLo[i] -= axUp;
+            rowUp[i] -= axLo;
+            colLive[j] = 0;
+            rowCount[i]--;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Write what is left back into model.
+    void store(MPSModel &model) {
+        int m = rowLo.size(), n = colLo.size();
+        std::vector<int> rowMap(m, -1);
+        MPSModel out;
+        out.name = model.name;
+        out.objName = model.objName;
+        out.objConst = objConst;
+        for (int i = 0; i < m; i++) {
+            if (!rowLive[i])
+                continue;
+            rowMap[i] = out.numRows();
+            double lo = rowLo[i], up = rowUp[i];
+            out.rowNames.push_back(model.rowNames[i]);
+            if (lo == up) {
+                out.rowType.push_back('E');
+                out.rhs.push_back(lo);
+                out.range.push_back(NAN);
+            } else if (!std::isfinite(lo)) {
+                out.rowType.push_back('L');
+                out.rhs.push_back(up);
+                out.range.push_back(NAN);
+            } else {
+                out.rowType.push_back('G');
+                out.rhs.push_back(lo);
+                out.range.push_back(std::isfinite(up) ? up - lo : NAN);
+            }
+        }
+        kept.clear();
+        for (int j = 0; j < n; j++) {
+            if (!colLive[j])
+                continue;
+            kept.push_back(j);
+            out.colNames.push_back(model.colNames[j]);
+            out.obj.push_back(cost[j]);
+            out.lower.push_back(colLo[j]);
+            out.upper.push_back(colUp[j]);
+            out.cols.emplace_back();
+            for (auto &e : cols[j])
+                if (rowLive[e.first])
+                    out.cols.back().emplace_back(rowMap[e.first], e.second);
+        }
+        rowsAfter = out.numRows();
+        colsAfter = out.numCols();
+        model = std::move(out);
+    }
+};
+
+#endif
@@ -0,0 +1,132 @@
+// Pricing rules for the tableau Simplex: how the entering column is picked
+// from the reduced costs in row m, and how Feasible() picks the infeasible
+// row to pivot on.
+//
+//   dantzig   largest reduced cost / most negative b (the original rule)
+//   partial   Dantzig over one segment of the columns at a time, taking the
+//             first segment with an improving column, rotating segments
+//   multiple  Dantzig over the MULTIPLE_COLUMNS best columns of the last
+//             full scan (topk.h) while any of them still improves, and a
+//             full scan, which picks the next ones, once none does
+//   devex     largest d_j^2 / w_j, with Forrest-Goldfarb reference weights
+//             updated from the pivot row in Pivot
+//   steepest  steepest edge: largest d_j^2 / (1 + |column j|^2) in phase 2,
+//             and dual steepest edge in Feasible(): largest b_i^2 /
+//             (1 + |row i|^2).  Pivot recomputes the norms exactly as it
+//             updates the tableau.
+//
+// SIMPLEX_PRICING selects one; Dantzig is the default.
+
+#ifndef PRICING_H
+#define PRICING_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include "kernels.h"
+
+namespace pricing {
+
+enum Rule { DANTZIG, PARTIAL, MULTIPLE, DEVEX, STEEPEST };
+
+inline const char *name(Rule r) {
+    static const char *names[] = {"dantzig", "partial", "multiple", "devex",
+                                  "steepest"};
+    return names[r];
+}
+
+inline Rule fromEnv() {
+    const char *env = getenv("SIMPLEX_PRICING");
+    if (env)
+        for (int r = DANTZIG; r <= STEEPEST; r++)
+            if (strcmp(env, name((Rule)r)) == 0)
+                return (Rule)r;
+    return DANTZIG;
+}
+
+// Columns multiple pricing keeps from a full scan.
+const int MULTIPLE_COLUMNS = 8;
+
+// Largest d[j]^2 / w[j] over d[j] > eps, as a Compare whose val is the
+// score.  Same contract as the kernels' scans: strictly better than best,
+// ties to the smallest index.
+template <class T>
+inline Compare argmaxWeighted(const T *d, const double *w, int begin, int end,
+                              double eps, Compare best) {
+    for (int j = begin; j < end; j++) {
+        if (d[j] > eps) {
+            double v = d[j] * d[j] / w[j];
+            if (v > best.val) {
+                best.val = v;
+                best.index = j;
+            }
+        }
+    }
+    return best;
+}
+
+// Largest b[i * stride]^2 / w[i] over b[i * stride] < -eps.
+template <class T>
+inline Compare argmaxInfeasible(const T *b, ptrdiff_t stride, const double *w,
+                                int begin, int end, double eps,
+                                Compare best) {
+    for (int i = begin; i < end; i++) {
+        double v = b[i * stride];
+        if (v < -eps) {
+            v = v * v / w[i];
+            if (v > best.val) {
+                best.val = v;
+                best.index = i;
+            }
+        }
+    }
+    return best;
+}
+
+// The same for bounded rows: largest r^2 / w[i] over the rows whose
+// b[i * stride] is more than eps outside [lower[i], upper[i]], by r, or
+// largest r if w is null.
+template <class T>
+inline Compare argmaxViolation(const T *b, ptrdiff_t stride,
+                               const double *lower, const double *upper,
+                               const double *w, int begin, int end,
+                               double eps, Compare best) {
+    for (int i = begin; i < end; i++) {
+        double v = b[i * stride];
+        double r = std::max(lower[i] - v, v - upper[i]);
+        if (r > eps) {
+            if (w)
+                r = r * r / w[i];
+            if (r > best.val) {
+                best.val = r;
+                best.index = i;
+            }
+        }
+    }
+    return best;
+}
+
+// Sum of x[0..n)^2.
+template <class T> inline double sumSquares(const T *x, int n) {
+    double s = 0;
+    for (int j = 0; j < n; j++)
+        s += x[j] * x[j];
+    return s;
+}
+
+// acc[0..n) += x[0..n)^2, and return the sum of x[0..n)^2.
+template <class T> inline double addSquares(double *acc, const T *x, int n) {
+    double s = 0;
+    for (int j = 0; j < n; j++) {
+        double v = x[j] * x[j];
+        acc[j] += v;
+        s += v;
+    }
+    return s;
+}
+
+} // namespace pricing
+
+#endif
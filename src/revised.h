@@ -0,0 +1,276 @@
+// Revised simplex engine: the same problem as Simplex,
+//     max c dot x s.t. a x <= b  x >= 0,
+// but instead of carrying the whole (m+1) x (n+1) tableau it keeps an LU
+// factorization of the basis (lu.h) and works from a sparse a (sparse.h).  Each iteration
+// computes only what it needs: the pricing vector y = B^-T c_B (BTRAN), the
+// reduced costs c_j - y dot a_j from the sparse columns, and the entering
+// column B^-1 a_q (FTRAN) for the ratio test.  So an iteration costs about
+// nnz(a) + the size of the factors rather than m * n.
+//
+// The slack of row i is variable n + i.  Phase 1 starts from the all-slack
+// basis and maximizes the sum of the negative basic variables (the rows with
+// b_i < 0 that Simplex's Feasible() pivots away); phase 2 then optimizes c.
+
+#ifndef REVISED_H
+#define REVISED_H
+
+#include <chrono>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "basis.h"
+#include "lu.h"
+#include "sparse.h"
+
+class RevisedSimplex {
+  private:
+    int m, n;
+    SparseMatrix A;                  // m x n, columns of the structurals
+    std::vector<double> b, c;        // c is 0 for the slacks
+    std::vector<int> basis;          // size m.  variable at each position
+    std::vector<int> position;       // size n + m.  position, or -1
+    std::vector<double> xB;          // basic variable values, by position
+    BasisFactor factor;
+    std::vector<double> work, alpha, y, cB;
+    std::vector<double> yA; // y A, size n, when pricing by rows
+
+    // Refactorize after this many product-form updates.
+    static const int REFACTOR = 100;
+
+  public:
+    std::vector<double> soln;
+    double z;    // return value of the objective function.
+    int lp_type; // for return.  1 if feasible, 0 if not feasible, -1 if
+                 // unbounded
+
+    const double INF;
+    const double EPS;
+    const static int FEASIBLE = 1;
+    const static int INFEASIBLE = 0;
+    const static int UNBOUNDED = -1;
+
+    /*
+      input:
+        m = #constraints, n =#variables, A0 = the m x n constraint matrix
+        max c dot x s.t. a x <= b  x >= 0
+      output:
+        lp_type, and when FEASIBLE z and the n-vector soln, as for Simplex.
+        The solve starts from start's basis if given, else the slack
+        basis, and GetBasis() is the final basis.  quiet turns off the
+        report on stdout.
+      caveats:
+        Dantzig pricing and a textbook ratio test, so cycling is possible.
+    */
+    RevisedSimplex(int m0, int n0, SparseMatrix &A0, std::vector<double> &B,
+                   std::vector<double> &C, const Basis *start = nullptr,
+                   bool quiet = false)
+        : m(m0), n(n0), A(std::move(A0)), b(B), c(C), basis(m0),
+          position(n0 + m0, -1), soln(n0), z(0), lp_type(INFEASIBLE),
+          INF(1e100), EPS(1e-9) {
+        c.resize(n + m, 0.0);
+        for (int i = 0; i < m; i++) {
+            basis[i] = n + i;
+            position[n + i] = i;
+        }
+        // refactor() replaces any columns that leave this basis singular.
+        if (start && (int)start->basic.size() == m) {
+            position.assign(n + m, -1);
+            for (int k = 0; k < m; k++) {
+                basis[k] = start->basic[k];
+                position[basis[k]] = k;
+            }
+        }
+        cB.resize(m);
+        yA.resize(n);
+
+        double findFeasibility = 0, findX = 0, findConstraint = 0,
+               findPivot = 0;
+        auto micros = [](std::chrono::steady_clock::time_point s) {
+            return (double)std::chrono::duration_cast<
+                       std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - s)
+                .count();
+        };
+
+        auto feasibilityStart = std::chrono::steady_clock::now();
+        refactor();
+        bool phase1 = true;
+        while (true) {
+            bool infeasible = false;
+            for (int k = 0; k < m; k++)
+                infeasible |= xB[k] < -EPS;
+            if (phase1 && !infeasible) {
+                phase1 = false;
+                findFeasibility = micros(feasibilityStart);
+            }
+
+            auto xStart = std::chrono::steady_clock::now();
+            for (int k = 0; k < m; k++)
+                cB[k] = phase1 ? (xB[k] < -EPS ? 1.0 : 0.0) : c[basis[k]];
+            factor.btran(cB, y);
+            int q = Price(phase1);
+            if (!phase1)
+                findX += micros(xStart);
+
+            if (q < 0) {
+                if (!phase1) {
+                    for (int j = 0; j < n; j++)
+                        soln[j] = position[j] < 0 ? 0 : xB[position[j]];
+                    z = 0;
+                    for (int j = 0; j < n; j++)
+                        z += c[j] * soln[j];
+                    lp_type = FEASIBLE;
+                }
+                break;
+            }
+
+            auto constraintStart = std::chrono::steady_clock::now();
+            work.assign(m, 0.0);
+            if (q < n)
+                A.axpyColumn(q, 1.0, work.data());
+            else
+                work[q - n] = 1.0;
+            factor.ftran(work, alpha);
+            int r = Ratio(phase1);
+            if (!phase1)
+                findConstraint += micros(constraintStart);
+
+            if (r < 0) {
+                // In phase 1 an improving column always meets a negative
+                // basic variable, so only round-off gets here.
+                if (!phase1)
+                    lp_type = UNBOUNDED;
+                break;
+            }
+
+            auto pivotStart = std::chrono::steady_clock::now();
+            Pivot(r, q);
+            if (!phase1)
+                findPivot += micros(pivotStart);
+        }
+        if (phase1)
+            findFeasibility = micros(feasibilityStart);
+
+        if (quiet)
+            return;
+        std::cout << std::fixed << "Time taken to find feasibility = " << (findFeasibility) << "[microseconds]" << std::endl;
+        std::cout << std::fixed << "Time taken to find variable to optimize = " << (findX) << "[microseconds]" << std::endl;
+        std::cout << std::fixed << "Time taken to search constraints to optimize variable = " << (findConstraint) << "[microseconds]" << std::endl;
+        std::cout << std::fixed << "Time taken to pivot to new vertex on polytope = " << (findPivot) << "[microseconds]" << std::endl;
+    }
+
+    Basis GetBasis() const {
+        Basis b;
+        b.m = m;
+        b.n = n;
+        b.basic = basis;
+        return b;
+    }
+
+  private:
+    // Call f(row, value) for each nonzero of variable j's column.
+    template <class F> void Column(int j, F f) const {
+        if (j >= n) {
+            f(j - n, 1.0);
+            return;
+        }
+        for (int e = A.colStart[j]; e < A.colStart[j + 1]; e++)
+            f(A.rowIndex[e], A.colValue[e]);
+    }
+
+    // Entering variable by Dantzig's rule (largest reduced cost), or -1.
+    // Phase 1 prices against the infeasibility costs already in y.
+    int Price(bool phase1) {
+        // y A through the row view when y is sparse (phase 1 usually has
+        // only a few infeasible rows), else one sparse dot per column.
+        int nzY = 0;
+        for (int i = 0; i < m; i++)
+            nzY += y[i] != 0;
+        bool byRow = nzY < m / 4;
+        if (byRow)
+            A.multiplyTranspose(y.data(), yA.data());
+
+        int q = -1;
+        double best = EPS;
+        for (int j = 0; j < n; j++) {
+            if (position[j] >= 0)
+                continue;
+            double d = (phase1 ? 0.0 : c[j]) -
+                       (byRow ? yA[j] : A.dotColumn(j, y.data()));
+            if (d > best) {
+                best = d;
+                q = j;
+            }
+        }
+        for (int i = 0; i < m; i++) {
+            if (position[n + i] < 0 && -y[i] > best) {
+                best = -y[i];
+                q = n + i;
+            }
+        }
+        return q;
+    }
+
+    // Leaving position for the entering column alpha, or -1.  Feasible
+    // basics must stay >= 0; in phase 1 a negative basic that rises to 0
+    // may leave too.  Ties go to the larger |alpha| for stability.
+    int Ratio(bool phase1) const {
+        int r = -1;
+        double best = INF, bestPiv = 0;
+        for (int k = 0; k < m; k++) {
+            double a = alpha[k], x = xB[k], t;
+            if (phase1 && x < -EPS) {
+                if (a >= -EPS)
+                    continue;
+                t = x / a;
+            } else {
+                if (a <= EPS)
+                    continue;
+                t = (x > 0 ? x : 0) / a;
+            }
+            double piv = a < 0 ? -a : a;
+            if (t < best || (t == best && piv > bestPiv)) {
+                best = t;
+                bestPiv = piv;
+                r = k;
+            }
+        }
+        return r;
+    }
+
+    // Variable q enters at position r.
+    void Pivot(int r, int q) {
+        double t = xB[r] / alpha[r];
+        if (t < 0) // a feasible basic within EPS of 0
+            t = 0;
+        for (int k = 0; k < m; k++)
+            xB[k] -= t * alpha[k];
+        xB[r] = t;
+        factor.update(r, alpha);
+        position[basis[r]] = -1;
+        basis[r] = q;
+        position[q] = r;
+        if (factor.updates() >= REFACTOR)
+            refactor();
+    }
+
+    // Factorize the current basis from scratch and recompute xB = B^-1 b.
+    void refactor() {
+        std::vector<std::vector<BasisFactor::Entry>> cols(m);
+        for (int k = 0; k < m; k++)
+            Column(basis[k],
+                   [&](int i, double v) { cols[k].emplace_back(i, v); });
+        std::vector<std::pair<int, int>> replaced;
+        factor.factor(m, cols, replaced);
+        for (auto &pr : replaced) {
+            position[basis[pr.first]] = -1;
+            basis[pr.first] = n + pr.second;
+            position[n + pr.second] = pr.first;
+        }
+        work = b;
+        factor.ftran(work, xB);
+    }
+};
+
+#endif
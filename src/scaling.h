@@ -0,0 +1,199 @@
+// Scaling of the constraint matrix before the solve: a' = R a S, with row
+// factors R = diag(row) and column factors S = diag(col), so the solvers'
+// absolute tolerances (EPS, harris::FEAS_TOL) mean about the same thing in
+// every row and column.  Netlib models mix entries many orders of magnitude
+// apart.
+//
+//   geometric    passes over the rows and then the columns, each dividing
+//                by the square root of its smallest and largest |a_ij|,
+//                while the spread max |a_ij| / min |a_ij| keeps shrinking
+//   equilibrate  one pass dividing each row and then each column by its
+//                largest |a_ij|, so every one of them peaks at about 1
+//
+// SIMPLEX_SCALING picks one, or off; the default is geometric passes
+// followed by equilibration.  Factors are powers of 2, so scaling and
+// unscaling round nothing.
+//
+// With b' = R b, c' = S c and bounds divided by col (and slack ranges
+// multiplied by row), x' = S^-1 x solves the scaled problem, and c' x' is
+// c x: z needs no unscaling, only the solution does.
+
+#ifndef SCALING_H
+#define SCALING_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "mps.h"
+#include "sparse.h"
+
+class Scaling {
+  public:
+    enum Method { OFF, GEOMETRIC, EQUILIBRATE, BOTH };
+
+    static Method fromEnv() {
+        const char *env = getenv("SIMPLEX_SCALING");
+        if (env && strcmp(env, "off") == 0)
+            return OFF;
+        if (env && strcmp(env, "geometric") == 0)
+            return GEOMETRIC;
+        if (env && strcmp(env, "equilibrate") == 0)
+            return EQUILIBRATE;
+        return BOTH;
+    }
+
+    std::vector<double> row, col;
+    // max |a_ij| / min |a_ij| over the nonzeros, before and after.
+    double spreadBefore = 1, spreadAfter = 1;
+
+    // Factors for a, which is left alone.
+    void compute(const SparseMatrix &a, Method method) {
+        row.assign(a.m, 1.0);
+        col.assign(a.n, 1.0);
+        spreadBefore = spreadAfter = spread(a);
+        if (method == GEOMETRIC || method == BOTH) {
+            for (int pass = 0; pass < MAX_PASSES; pass++) {
+                std::vector<double> lastRow(row), lastCol(col);
+                geometricRows(a);
+                geometricCols(a);
+                double s = spread(a);
+                if (s >= spreadAfter) {
+                    // No better: back to the factors before this pass.
+                    row.swap(lastRow);
+                    col.swap(lastCol);
+                    break;
+                }
+                // Less than 10% better: keep it, but stop here.
+                bool last = s > 0.9 * spreadAfter;
+                spreadAfter = s;
+                if (last)
+                    break;
+            }
+        }
+        if (method == EQUILIBRATE || method == BOTH) {
+            equilibrateRows(a);
+            equilibrateCols(a);
+        }
+        for (double &r : row)
+            r = powerOf2(r);
+        for (double &s : col)
+            s = powerOf2(s);
+        spreadAfter = spread(a);
+    }
+
+    // Scale the standard form in place, bounds included.
+    void apply(StandardForm &sf) const {
+        SparseMatrix &a = sf.A;
+        for (int j = 0; j < a.n; j++)
+            for (int e = a.colStart[j]; e < a.colStart[j + 1]; e++)
+                a.colValue[e] *= row[a.rowIndex[e]] * col[j];
+        for (int i = 0; i < a.m; i++)
+            for (int e = a.rowStart[i]; e < a.rowStart[i + 1]; e++)
+                a.rowValue[e] *= row[i] * col[a.colIndex[e]];
+        for (int i = 0; i < sf.m; i++)
+            sf.B[i] *= row[i];
+        for (int j = 0; j < sf.n; j++)
+            sf.C[j] *= col[j];
+        Bounds &bd = sf.bounds;
+        for (size_t j = 0; j < bd.lower.size(); j++) {
+            bd.lower[j] /= col[j];
+            bd.upper[j] /= col[j];
+        }
+        for (size_t i = 0; i < bd.range.size(); i++)
+            bd.range[i] *= row[i];
+    }
+
+    // The same for a dense m x n problem: the matrix, of any element type,
+    // and then b and c.
+    template <class Rows> void apply(Rows &a) const {
+        for (size_t i = 0; i < row.size(); i++)
+            for (size_t j = 0; j < col.size(); j++)
+                a[i][j] *= row[i] * col[j];
+    }
+
+    void apply(std::vector<double> &b, std::vector<double> &c) const {
+        for (size_t i = 0; i < row.size(); i++)
+            b[i] *= row[i];
+        for (size_t j = 0; j < col.size(); j++)
+            c[j] *= col[j];
+    }
+
+    // x from the scaled problem's x'.
+    void unscale(std::vector<double> &x) const {
+        for (size_t j = 0; j < col.size() && j < x.size(); j++)
+            x[j] *= col[j];
+    }
+
+  private:
+    static const int MAX_PASSES = 20;
+
+    static double powerOf2(double f) {
+        return std::exp2(std::round(std::log2(f)));
+    }
+
+    double spread(const SparseMatrix &a) const {
+        double lo = INFINITY, hi = 0;
+        for (int j = 0; j < a.n; j++) {
+            for (int e = a.colStart[j]; e < a.colStart[j + 1]; e++) {
+                double v =
+                    std::fabs(a.colValue[e]) * row[a.rowIndex[e]] * col[j];
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
+            }
+        }
+        return hi > 0 ? hi / lo : 1;
+    }
+
+    void geometricRows(const SparseMatrix &a) {
+        for (int i = 0; i < a.m; i++) {
+            double lo = INFINITY, hi = 0;
+            for (int e = a.rowStart[i]; e < a.rowStart[i + 1]; e++) {
+                double v = std::fabs(a.rowValue[e]) * col[a.colIndex[e]];
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
+            }
+            if (hi > 0)
+                row[i] = 1 / std::sqrt(lo * hi);
+        }
+    }
+
+    void geometricCols(const SparseMatrix &a) {
+        for (int j = 0; j < a.n; j++) {
+            double lo = INFINITY, hi = 0;
+            for (int e = a.colStart[j]; e < a.colStart[j + 1]; e++) {
+                double v = std::fabs(a.colValue[e]) * row[a.rowIndex[e]];
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
+            }
+            if (hi > 0)
+                col[j] = 1 / std::sqrt(lo * hi);
+        }
+    }
+
+    void equilibrateRows(const SparseMatrix &a) {
+        for (int i = 0; i < a.m; i++) {
+            double hi = 0;
+            for (int e = a.rowStart[i]; e < a.rowStart[i + 1]; e++)
+                hi = std::max(hi, std::fabs(a.rowValue[e]) *
+                                      col[a.colIndex[e]]);
+            if (hi > 0)
+                row[i] = 1 / hi;
+        }
+    }
+
+    void equilibrateCols(const SparseMatrix &a) {
+        for (int j = 0; j < a.n; j++) {
+            double hi = 0;
+            for (int e = a.colStart[j]; e < a.colStart[j + 1]; e++)
+                hi = std::max(hi, std::fabs(a.colValue[e]) *
+                                      row[a.rowIndex[e]]);
+            if (hi > 0)
+                col[j] = 1 / hi;
+        }
+    }
+};
+
+#endif
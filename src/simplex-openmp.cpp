@@ -8,343 +8,611 @@
 #include <chrono>
 #include <omp.h>
 #include <random>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "basis.h"
+#include "mps.h"
+#include "numa.h"
+#include "presolve.h"
+#include "revised.h"
+#include "scaling.h"
+#include "simplex.h"
+#include "small.h"
+#include "tableau.h"
 
 using namespace std;
 
-struct Compare { double val; int index; };    
-#pragma omp declare reduction(minimum : struct Compare : omp_out = omp_in.val < omp_out.val ? omp_in : omp_out) initializer (omp_priv=omp_orig)
-#pragma omp declare reduction(maximum : struct Compare : omp_out = omp_in.val > omp_out.val ? omp_in : omp_out) initializer (omp_priv=omp_orig)
+// Read the MPS model at path into mps, presolve a copy of it unless
+// SIMPLEX_PRESOLVE=off or a basis file is in use, and convert that to the
+// standard form the solver takes: the row form for the revised engine,
+// SIMPLEX_BOUNDS=rows or SmallSimplex, else the bounded form, as bounded
+// then says.  presolve comes back ready to postsolve the solution to mps.
+// small says whether SmallSimplex may take the model and comes back saying
+// whether it will.  verbose prints presolve's report.  Prints a diagnostic
+// and returns false if the model can't be read.
+static bool loadModel(const char *path, bool rowForm, bool verbose,
+                      bool &small, bool &bounded, MPSModel &mps,
+                      Presolve &presolve, StandardForm &model) {
+    if (!loadMPS(path, mps))
+        return false;
+    MPSModel solved = mps;
+    // Models are presolved (presolve.h) unless SIMPLEX_PRESOLVE=off.  Basis
+    // files hold the model as written, not presolve's reduction of it, so
+    // not with them either.
+    const char *pre = getenv("SIMPLEX_PRESOLVE");
+    bool basisFile = getenv("SIMPLEX_BASIS_IN") || getenv("SIMPLEX_BASIS_OUT");
+    if (basisFile && verbose)
+        cout << "Presolve: off for basis files" << std::endl;
+    if (!(pre && strcmp(pre, "off") == 0) && !basisFile) {
+        bool reduced = presolve.run(solved);
+        if (verbose && reduced)
+            cout << "Presolve: " << presolve.rowsBefore << " x "
+                 << presolve.colsBefore << " -> " << presolve.rowsAfter
+                 << " x " << presolve.colsAfter << std::endl;
+        else if (verbose)
+            cout << "Presolve: infeasible or unbounded, left as is"
+                 << std::endl;
+    }
+    // The tableau takes bounds, ranges and free variables as they are,
+    // unless SIMPLEX_BOUNDS=rows; the revised engine and race mode (rowForm)
+    // need them as rows and split columns.
+    const char *rows = getenv("SIMPLEX_BOUNDS");
+    bounded = !rowForm && !(rows && strcmp(rows, "rows") == 0);
+    // SmallSimplex takes the row form only, if that fits.
+    if (small) {
+        toStandardForm(solved, model, false);
+        small = model.m <= SMALL_MAX && model.n <= SMALL_MAX;
+        if (small)
+            bounded = false;
+    }
+    if (!small)
+        toStandardForm(solved, model, bounded);
+    return true;
+}
 
-class Simplex {
+// The model's x, postsolved to the model as read, as the last line of a
+// solve's report: its objective, which should be the optimum printed above,
+// and how far it is outside the model's rows and bounds
+// (MPSModel::violation).
+static void reportSolution(const MPSModel &model,
+                           const std::vector<double> &x) {
+    std::cout << "Solution: objective " << fixed << model.objective(x)
+              << ", worst violation " << std::scientific << model.violation(x)
+              << fixed << std::endl;
+}
 
-  private:
-    int m, n;
-    std::vector<std::vector<double>> A;
-    std::vector<int> basic;    // size m.  indices of basic vars
-    std::vector<int> nonbasic; // size n.  indices of non-basic vars
-    // time taken during different parts of the Simplex algorithm
-
-  public:
-    std::vector<double> soln;
-    double z;    // return value of the objective function.
-    int lp_type; // for return.  1 if feasible, 0 if not feasible, -1 if
-                 // unbounded
-
-    const double INF; // unbelivably, C++ doesn't support static doubles
-                      // initialized in a class
-    const double EPS;
-    const static int FEASIBLE = 1; // int vars are ok though
-    const static int INFEASIBLE = 0;
-    const static int UNBOUNDED = -1;
-
-    /*
-      input:
-        m = #constraints, n =#variables
-        max c dot x s.t. a x <= b  x >= 0
-        where a = mxn, b = m vector, c = n vector
-      output:
-        Infeasible, or Unbounded, or a pair Feasible (z,soln) where z is
-        the maximum objective function value, and soln is an n-vector of
-        variable values.
-      caveats:
-        Cycling is possible.  Nothing is done to mitigate loss of
-        precision when the number of iterations is large.
-    */
-    Simplex(int m0, int n0, std::vector<std::vector<double>> &A0,
-            std::vector<double> &B, std::vector<double> &C)
-        : m(m0), n(n0), A(std::move(A0)), basic(m0), nonbasic(n0), soln(n), INF(1e100),
-          EPS(1e-9)
+// Batch mode: ./simplex-openmp --batch manifest solves every problem the
+// manifest lists, one per line: the path of an MPS model, or "m n" for the
+// random problem ./simplex-openmp m n solves.  Blank lines and lines
+// starting with # are skipped.
+//
+// Everything runs on OpenMP's one pool of threads.  The problems are read,
+// presolved and scaled in parallel.  Those whose tableau has at most
+// BATCH_ALONE entries are then solved one per thread, largest first, each
+// Simplex's parallel region running on just the thread that started it; a
+// pivot on them is too short to share.  The rest follow one at a time on
+// the whole team, as ./simplex-openmp would solve them.  The results print
+// in manifest order.
+//
+// Options apply as they do to one problem, except those for what follows
+// a solve (basis files, re-solves, cuts) and SIMPLEX_PRECISION=float.
+static const long BATCH_ALONE = 1 << 16;
+
+struct BatchJob {
+    std::string spec; // the manifest line
+    bool loaded = false;
+    bool fromFile = false;
+    bool small = false, bounded = false;
+    MPSModel mps; // as read, before presolve
+    Presolve presolve;
+    StandardForm model; // model.A is freed once solved
+    Scaling scaling;
+    long size = 0;      // tableau entries
+    int lp_type = Simplex<double>::INFEASIBLE;
+    double z = 0;
+    std::vector<double> soln; // unscaled
+    long micros = 0;
+};
 
-    {
-        // A = std::move(A0);
-        // m constraints, n variables here
-
-        // Create constraint matrix, resize to add the B matrix as the last column
-        // #pragma omp parallel
-        // {
-            // #pragma clang loop vectorize(enable)
-            #pragma clang loop interleave(enable)
-            for (int j = 0; j < m; j++)
-                basic[j] = n + j;
-
-            // #pragma clang loop vectorize(enable)
-            #pragma clang loop interleave(enable)
-            for (int i = 0; i < n; i++)
-                nonbasic[i] = i;
-            
-            // # pragma omp parallel for
-            #pragma clang loop unroll(enable)
-            // #pragma clang loop interleave(enable)
-            for (int i = 0; i < m; i++) 
-                A[i][n] = B[i];
-
-            // Add c vector to A
-            // #pragma omp parallel for
-            #pragma clang loop interleave(enable)
+static void loadJob(BatchJob &job, bool revised, bool small,
+                    Scaling::Method scaleMethod) {
+    StandardForm &sf = job.model;
+    std::istringstream fields(job.spec);
+    int m, n;
+    std::string extra;
+    if (fields >> m >> n && !(fields >> extra)) {
+        // The same draws as main's random problem.
+        std::mt19937 gen(1);
+        std::uniform_real_distribution<double> randReal(0, 100000.f);
+        Tableau T(m + 1, n + 1);
+        for (int i = 0; i < m; i++)
             for (int j = 0; j < n; j++)
-                A[m][j] = C[j];
-        // }
-
-        double findFeasibility, findX, findConstraint, findPivot;
-
-        auto feasibilityStart = std::chrono::steady_clock::now();
-        // Don't run simplex on an infeasible LP
-        bool isFeasible = Feasible();
-        auto feasibilityEnd = (std::chrono::steady_clock::now());
-        findFeasibility = std::chrono::duration_cast<std::chrono::microseconds>(feasibilityEnd - feasibilityStart).count();
-
-        if (!isFeasible) {
-            lp_type = INFEASIBLE;
+                T[i][j] = randReal(gen);
+        sf.m = m;
+        sf.n = n;
+        sf.A = SparseMatrix::fromDense(m, n, T);
+        sf.B.resize(m);
+        for (int i = 0; i < m; i++)
+            sf.B[i] = randReal(gen);
+        sf.C.resize(n);
+        for (int j = 0; j < n; j++)
+            sf.C[j] = randReal(gen);
+        job.small = small && m <= SMALL_MAX && n <= SMALL_MAX;
+    } else {
+        job.fromFile = true;
+        job.small = small;
+        if (!loadModel(job.spec.c_str(), revised, false, job.small,
+                       job.bounded, job.mps, job.presolve, sf))
             return;
-        }
-
-        findX = 0;
-        findConstraint = 0;
-        findPivot = 0;
-
-        while (true) {
-            int r = 0, c = 0;
-            double p = 0.0;
-            
-            auto xStart = std::chrono::steady_clock::now();
-            struct Compare max;
-            max.val = p;
-            max.index = c;
-            for (int i = 0; i < n; i++) {
-                if (A[m][i] > max.val) {
-                    max.val = A[m][i];
-                    max.index = i;
-                }
-            }
-            p = max.val; 
-            c = max.index;
-            auto xEnd = std::chrono::steady_clock::now();
-            findX += std::chrono::duration_cast<std::chrono::microseconds>(xEnd - xStart).count();
-
-            # pragma omp parallel
-            {
-                if (p < EPS) {
-                    #pragma omp for
-                    for (int j = 0; j < n; j++)
-                        if (nonbasic[j] < n)
-                            soln[nonbasic[j]] = 0;
-
-                    # pragma omp for
-                    for (int i = 0; i < m; i++)
-                        if (basic[i] < n)
-                            soln[basic[i]] = A[i][n];
-                    
-                    z = -A[m][n];
-                    lp_type = FEASIBLE;
-                }
-            }
-            if (lp_type == FEASIBLE) break;
-
-            p = INF;
-            
-            struct Compare min;
-            min.val = p;
-            min.index = r;
-
-            auto constraintStart = std::chrono::steady_clock::now();
-            #pragma omp parallel for reduction(minimum:min)
-            for (int i = 0; i < m; i++) {
-                if (A[i][c] > EPS) {
-                    double val = A[i][n] / A[i][c];
-                    if (val < min.val) {
-                        min.val = val;
-                        min.index = i;
-                    }
-                }
-            }
-            p = min.val;
-            r = min.index;
-            auto constraintEnd = std::chrono::steady_clock::now();
-            findConstraint += std::chrono::duration_cast<std::chrono::microseconds>(constraintEnd - constraintStart).count();
-
-            if (p == INF) {
-                lp_type = UNBOUNDED;
-                break;
-            }
-            auto pivotStart = std::chrono::steady_clock::now();
-            Pivot(r, c);
-            auto pivotEnd = std::chrono::steady_clock::now();
-            findPivot += std::chrono::duration_cast<std::chrono::microseconds>(pivotEnd - pivotStart).count();
-        }
-
-        std::cout << fixed << "Time taken to find feasibility = " << (findFeasibility) << "[microseconds]" << std::endl;
-        std::cout << fixed << "Time taken to find variable to optimize = " << (findX) << "[microseconds]" << std::endl;
-        std::cout << fixed << "Time taken to search constraints to optimize variable = " << (findConstraint) << "[microseconds]" << std::endl;
-        std::cout << fixed << "Time taken to pivot to new vertex on polytope = " << (findPivot) << "[microseconds]" << std::endl;
     }
+    if (scaleMethod != Scaling::OFF) {
+        job.scaling.compute(sf.A, scaleMethod);
+        job.scaling.apply(sf);
+    }
+    job.size = (long)(sf.m + 1) * (sf.n + 1);
+    job.loaded = true;
+}
 
-  private:
-    void printa() {
-        int i, j;
-        for (i = 0; i <= m; i++) {
-            for (j = 0; j <= n; j++) {
-                printf("A[%d][%d] = %f\n", i, j, A[i][j]);
-            };
+static void solveJob(BatchJob &job, bool revised) {
+    StandardForm &sf = job.model;
+    auto begin = std::chrono::steady_clock::now();
+    if (revised) {
+        RevisedSimplex lp(sf.m, sf.n, sf.A, sf.B, sf.C, nullptr, true);
+        job.lp_type = lp.lp_type;
+        job.z = lp.z;
+        job.soln = lp.soln;
+    } else {
+        Tableau A;
+        numa::place(A, sf.m + 1, sf.n + 1,
+                    Simplex<double>::TileRows(sf.m, omp_get_max_threads()));
+        for (int i = 0; i < sf.m; i++)
+            sf.A.scatterRow(i, A[i]);
+        sf.A = SparseMatrix();
+        if (job.small) {
+            SmallResult lp;
+            solveSmall(sf.m, sf.n, A, sf.B.data(), sf.C.data(), lp);
+            job.lp_type = lp.lp_type;
+            job.z = lp.z;
+            job.soln = lp.soln;
+        } else {
+            Simplex<double> lp(sf.m, sf.n, A, sf.B, sf.C, nullptr,
+                               job.bounded ? &sf.bounds : nullptr, true);
+            job.lp_type = lp.lp_type;
+            job.z = lp.z;
+            job.soln = lp.soln;
         }
     }
+    job.scaling.unscale(job.soln);
+    job.micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count();
+}
 
-    void Pivot(int r, int c) {
-        swap(basic[r], nonbasic[c]);
+// Returns main's exit status: 1 if the manifest or any model in it can't
+// be read.
+static int runBatch(const char *manifest) {
+    std::ifstream in(manifest);
+    if (!in) {
+        std::cerr << "can't open " << manifest << std::endl;
+        return 1;
+    }
+    std::vector<BatchJob> jobs;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+        jobs.emplace_back();
+        jobs.back().spec =
+            line.substr(first, line.find_last_not_of(" \t\r") + 1 - first);
+    }
 
-        A[r][c] = 1 / A[r][c];
-        # pragma clang loop vectorize(assume_safety)
-        for (int j = 0; j < n+1; j++) {
-            if (j != c)
-                A[r][j] *= A[r][c];
+    const char *engine = getenv("SIMPLEX_ENGINE");
+    bool revised = engine && std::string(engine) == "revised";
+    const char *smallEnv = getenv("SIMPLEX_SMALL");
+    bool small = !revised && !(smallEnv && strcmp(smallEnv, "off") == 0);
+    Scaling::Method scaleMethod = Scaling::fromEnv();
+    // One level of parallelism: a Simplex inside the loop below gets a
+    // team of one.
+    omp_set_max_active_levels(1);
+    numa::pin();
+
+    auto begin = std::chrono::steady_clock::now();
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int k = 0; k < (int)jobs.size(); k++)
+        loadJob(jobs[k], revised, small, scaleMethod);
+
+    std::vector<int> alone, shared;
+    for (int k = 0; k < (int)jobs.size(); k++) {
+        if (!jobs[k].loaded)
+            continue;
+        if (jobs[k].size <= BATCH_ALONE)
+            alone.push_back(k);
+        else
+            shared.push_back(k);
+    }
+    // Largest first, so the last few to start are short.
+    std::stable_sort(alone.begin(), alone.end(), [&](int a, int b) {
+        return jobs[a].size > jobs[b].size;
+    });
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int k = 0; k < (int)alone.size(); k++)
+        solveJob(jobs[alone[k]], revised);
+    for (int k : shared)
+        solveJob(jobs[k], revised);
+    auto end = std::chrono::steady_clock::now();
+
+    int status = 0;
+    for (const BatchJob &job : jobs) {
+        std::cout << job.spec << ": ";
+        if (!job.loaded) {
+            std::cout << "not loaded" << std::endl;
+            status = 1;
+            continue;
         }
+        if (job.lp_type == Simplex<double>::UNBOUNDED)
+            std::cout << "unbounded";
+        else if (job.lp_type == Simplex<double>::INFEASIBLE)
+            std::cout << "infeasible";
+        else
+            std::cout << "The optimum is " << fixed
+                      << (job.fromFile ? job.model.objective(job.z) : job.z);
+        std::cout << " in " << job.micros << "[µs]" << std::endl;
+        if (job.fromFile && job.lp_type == Simplex<double>::FEASIBLE)
+            reportSolution(job.mps, job.presolve.postsolve(
+                                        job.model.solution(job.soln)));
+    }
+    std::cout << "Batch: " << jobs.size() << " problems, " << alone.size()
+              << " one per thread and " << shared.size() << " on all "
+              << omp_get_max_threads() << " threads, in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     end - begin)
+                     .count()
+              << "[ms]" << std::endl;
+    return status;
+}
 
-        std::vector<double> rCol = A[r];
-
-        std::vector<double> cRow;
-        cRow.reserve(m + 1);
-        for (int i = 0; i < m + 1; i++)
-        {
-            cRow.push_back(A[i][c]);
-        }
-        
-        # pragma omp parallel
+// Race mode (SIMPLEX_RACE=on): which of a problem and its dual takes fewer
+// pivots varies from model to model and can't be told beforehand, so both
+// are solved at once and the first to finish wins.  The primal
+//     max c x s.t. a x <= b  x >= 0
+// has the dual min b y s.t. a^T y >= c  y >= 0, solved as
+//     max -b y s.t. -a^T y <= -c  y >= 0,
+// whose optimum is minus the primal's.  A dual that is unbounded makes the
+// primal infeasible.  An infeasible dual leaves the primal either
+// infeasible or unbounded, which only the primal can tell, so it doesn't
+// end the race.
+//
+// The two Simplexes run in nested parallel regions, the primal on half the
+// threads (rounded up) and the dual on the rest, at least one each.  The
+// winner sets a flag that the loser's Solve checks at every pivot, so it
+// stops within one pivot.  Models race in row form (bounds as rows), the
+// only one the dual is built from here.  The primal's x, when the dual
+// wins, is the dual's dual values.
+static void solveRace(int m, int n, Tableau &A, std::vector<double> &B,
+                      std::vector<double> &C, int &lp_type, double &z,
+                      std::vector<double> &soln) {
+    int nt = omp_get_max_threads();
+    int primalThreads = std::max(1, (nt + 1) / 2);
+    int dualThreads = std::max(1, nt / 2);
+
+    // The dual's tableau is a's transpose, negated, in tiles so that both
+    // sides stream through whole cache lines.
+    const int TILE = 32;
+    Tableau D;
+    numa::place(D, n + 1, m + 1, Simplex<double>::TileRows(n, dualThreads));
+    #pragma omp parallel for schedule(static)
+    for (int j0 = 0; j0 < n; j0 += TILE)
+        for (int i0 = 0; i0 < m; i0 += TILE)
+            for (int j = j0; j < std::min(j0 + TILE, n); j++)
+                for (int i = i0; i < std::min(i0 + TILE, m); i++)
+                    D[j][i] = -A[i][j];
+    std::vector<double> dualB(n), dualC(m);
+    for (int j = 0; j < n; j++)
+        dualB[j] = -C[j];
+    for (int i = 0; i < m; i++)
+        dualC[i] = -B[i];
+
+    std::atomic<bool> done(false);
+    const char *winner = "neither";
+    int primalPivots = 0, dualPivots = 0;
+    int levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(2);
+    #pragma omp parallel sections num_threads(2)
+    {
+        #pragma omp section
         {
-            #pragma omp for
-            for (int i = 0; i < m+1; i++) {
-                    if (i != r) {
-                        for (int j = 0; j < c; j++) {
-                                A[i][j] -= cRow[i] * rCol[j];
-                        }
-                        for (int j = c+1; j < n+1; j++) {
-                                A[i][j] -= cRow[i] * rCol[j];
-                        }
-                    }
+            omp_set_num_threads(primalThreads);
+            Simplex<double> lp(m, n, A, B, C, nullptr, nullptr, true, &done);
+            primalPivots = lp.installPivots + lp.pivots;
+            if (!lp.stopped && !done.exchange(true)) {
+                winner = "primal";
+                lp_type = lp.lp_type;
+                z = lp.z;
+                soln = lp.soln;
             }
         }
-
-        #pragma clang unroll(enable)
-        for (int i = 0; i < m+1; i++) {
-            if (i != r)
-                A[i][c] = -A[i][c] * A[r][c];
-        }
-    }
-
-    bool Feasible() {
-        int r = 0, c = 0;
-        while (true) {
-            double p = INF;
-            
-            struct Compare min;
-            min.val = p;
-            min.index = r;
-            #pragma omp parallel for reduction(minimum:min)
-            for (int i = 0; i < m; i++) {
-                if (A[i][n] < min.val) {
-                    min.val = A[i][n];
-                    min.index = i;
-                }
-            }
-            p = min.val; 
-            r = min.index;
-
-            if (p > -EPS)
-                return true;
-            
-            p = 0.0;
-            min.val = p;
-            min.index = c;
-            #pragma omp parallel for reduction(minimum:min)
-            for (int i = 0; i < n; i++) {
-                if (A[r][i] < min.val) {
-                    min.val = A[r][i];
-                    min.index = i;
-                }
-            }
-            p = min.val; 
-            c = min.index;
-
-            if (p > -EPS)
-                return false;
-            
-            p = A[r][n] / A[r][c];
-            
-            min.val = p;
-            min.index = r;
-
-            #pragma omp parallel for reduction(minimum:min)
-            for (int i = r + 1; i < m; i++) {
-                if (A[i][c] > EPS) {
-                    double val = A[i][n] / A[i][c];
-                    if (val < min.val) {
-                        min.val = val;
-                        min.index = i;
-                    }
-                }
+        #pragma omp section
+        {
+            omp_set_num_threads(dualThreads);
+            Simplex<double> lp(n, m, D, dualB, dualC, nullptr, nullptr, true,
+                               &done);
+            dualPivots = lp.installPivots + lp.pivots;
+            if (!lp.stopped && lp.lp_type != Simplex<double>::INFEASIBLE &&
+                !done.exchange(true)) {
+                winner = "dual";
+                lp_type = lp.lp_type == Simplex<double>::FEASIBLE
+                              ? Simplex<double>::FEASIBLE
+                              : Simplex<double>::INFEASIBLE;
+                z = -lp.z;
+                soln = lp.Duals();
             }
-            p = min.val; 
-            r = min.index;
-
-            Pivot(r, c);
         }
     }
-};
+    omp_set_max_active_levels(levels);
+    std::cout << fixed << "Race: " << winner << " won; primal " << primalPivots
+              << " pivots on " << primalThreads << " threads, dual "
+              << dualPivots << " pivots on " << dualThreads << " threads"
+              << std::endl;
+}
 
 int main(int argc, char *argv[]) {
+    // Before sync_with_stdio(false): batch mode's threads may write to
+    // std::cerr at once, which is only safe on synchronized streams.
+    if (argc == 3 && strcmp(argv[1], "--batch") == 0)
+        return runBatch(argv[2]);
+
     ios_base::sync_with_stdio(false);
     cin.tie(NULL);
-    std::vector<std::vector<double>> A;
-
-    int numRules = atoi(argv[1]);
-    int numVars = atoi(argv[2]);
+    Tableau A;
+    std::vector<double> B;
+    std::vector<double> C;
+    int numRules, numVars;
+
+    // SIMPLEX_ENGINE=revised solves with the LU-factorized revised simplex
+    // instead of the dense tableau.
+    const char *engine = getenv("SIMPLEX_ENGINE");
+    bool revised = engine && std::string(engine) == "revised";
+
+    // SIMPLEX_PRECISION=float solves on a float tableau first, then refines
+    // in double: a double tableau, rebuilt from the data, starts from the
+    // basis the float solve ended with and pivots on to the optimum.
+    const char *precision = getenv("SIMPLEX_PRECISION");
+    bool single = !revised && precision && strcmp(precision, "float") == 0;
+
+    // Problems of up to SMALL_MAX rows and columns go to SmallSimplex
+    // (small.h), unless SIMPLEX_SMALL=off or an option needs the tableau
+    // Simplex after the solve.
+    const char *smallEnv = getenv("SIMPLEX_SMALL");
+    bool after = getenv("SIMPLEX_BASIS_IN") || getenv("SIMPLEX_BASIS_OUT");
+    bool small = !revised && !single &&
+                 !(smallEnv && strcmp(smallEnv, "off") == 0) && !after;
+
+    // SIMPLEX_RACE=on solves the problem and its dual at once, each on half
+    // the threads, and takes whichever finishes first (see below).  Not with
+    // the other engines, or with an option that needs the primal's basis.
+    const char *raceEnv = getenv("SIMPLEX_RACE");
+    bool race = !revised && !single && !after && raceEnv &&
+                strcmp(raceEnv, "on") == 0;
+    small = small && !race;
+
+    // Threads are pinned (numa.h), except in race mode: each side's team
+    // would inherit the one CPU of the thread that starts it.
+    if (!race)
+        numa::pin();
+
+    // ./simplex-openmp model.mps solves a netlib model, ./simplex-openmp m n
+    // a random m by n problem.
+    MPSModel mps; // as read, before presolve
+    Presolve presolve;
+    StandardForm model;
+    bool fromFile = argc == 2;
+    // The problem is scaled (scaling.h) unless SIMPLEX_SCALING=off.
+    Scaling scaling;
+    Scaling::Method scaleMethod = Scaling::fromEnv();
+    bool bounded = false;
+    if (fromFile) {
+        if (!loadModel(argv[1], revised || race, true, small, bounded, mps,
+                       presolve, model))
+            return 1;
+        if (scaleMethod != Scaling::OFF) {
+            scaling.compute(model.A, scaleMethod);
+            scaling.apply(model);
+        }
+        numRules = model.m;
+        numVars = model.n;
+        B = std::move(model.B);
+        C = std::move(model.C);
+    } else {
+        numRules = atoi(argv[1]);
+        numVars = atoi(argv[2]);
+        small = small && numRules <= SMALL_MAX && numVars <= SMALL_MAX;
+        // Named for basis files.
+        plainStandardForm(numRules, numVars, model);
+    }
 
     cout << "Input size is " << numRules << " by " << numVars << std::endl;
 
+    SparseMatrix S;
+
     std::mt19937 randGen(1);
     std::uniform_real_distribution<double>randReal(0, 100000.f);
 
     auto randFloat = [&](){return randReal(randGen) ;};
 
-    A.resize(numRules + 1);
-    for (int i = 0; i < numRules + 1; i++) {
-        A[i].resize(numVars + 1);
-    }
-    for (int i = 0; i < numRules; i++) {
-        for (int j = 0; j < numVars; j++) {
-            // std::cin >> A[i][j];
-            A[i][j] = randFloat();
+    BasicTableau<float> F;
+
+    // Fill a tableau of either precision with a: the model's, or the random
+    // problem's as drawn from gen, which must start where randGen did.
+    auto fill = [&](auto &T, std::mt19937 &gen) {
+        numa::place(T, numRules + 1, numVars + 1,
+                    Simplex<double>::TileRows(numRules, omp_get_max_threads()));
+        for (int i = 0; i < numRules; i++) {
+            if (fromFile) {
+                model.A.scatterRow(i, T[i]);
+                continue;
+            }
+            for (int j = 0; j < numVars; j++) {
+                // std::cin >> A[i][j];
+                T[i][j] = randReal(gen);
+            }
+        }
+    };
+
+    if (fromFile) {
+        // Models stay sparse unless the tableau engine needs them dense,
+        // and then until the float solve's refinement.
+        if (revised) {
+            S = std::move(model.A);
+        } else if (single) {
+            fill(F, randGen);
+        } else {
+            fill(A, randGen);
+            model.A = SparseMatrix();
+        }
+    } else {
+        if (single)
+            fill(F, randGen);
+        else
+            fill(A, randGen);
+
+        B.resize(numRules);
+        for (int i = 0; i < numRules; i++) {
+            // std::cin >> B[i];
+            B[i] = randFloat();
         }
-    }
 
-    std::vector<double> B;
-    B.resize(numRules);
-    for (int i = 0; i < numRules; i++) {
-        // std::cin >> B[i];
-        B[i] = randFloat();
+        C.resize(numVars);
+        for (int i = 0; i < numVars; i++) {
+            // std::cin >> C[i];
+            C[i] = randFloat();
+        }
+        if (scaleMethod != Scaling::OFF) {
+            if (single) {
+                scaling.compute(SparseMatrix::fromDense(numRules, numVars, F),
+                                scaleMethod);
+                scaling.apply(F);
+            } else {
+                scaling.compute(SparseMatrix::fromDense(numRules, numVars, A),
+                                scaleMethod);
+                scaling.apply(A);
+            }
+            scaling.apply(B, C);
+        }
     }
+    if (scaleMethod != Scaling::OFF)
+        cout << "Scaling: max/min |a_ij| " << scaling.spreadBefore << " -> "
+             << scaling.spreadAfter << std::endl;
 
-    std::vector<double> C;
-    C.resize(numVars);
-    for (int i = 0; i < numVars; i++) {
-        // std::cin >> C[i];
-        C[i] = randFloat();
-    }
 
 
+    if (revised && !fromFile) {
+        S = SparseMatrix::fromDense(numRules, numVars, A);
+        A = Tableau();
+    }
 
+    // SIMPLEX_BASIS_IN=file starts from the basis in a BAS file (basis.h),
+    // and SIMPLEX_BASIS_OUT=file saves the final one there.  Both are of
+    // the model as written: loadModel skips presolve for them.
+    const char *basisIn = getenv("SIMPLEX_BASIS_IN");
+    const char *basisOut = getenv("SIMPLEX_BASIS_OUT");
+    Basis start, final;
+    if (basisIn && !readBasis(basisIn, model, start))
+        return 1;
+
+    if (!small && !revised) {
+        if (single)
+            numa::report(F);
+        else
+            numa::report(A);
+    }
     std::cout << "Loaded"  << std::endl;
     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 
-    Simplex lp(numRules, numVars, A, B, C);
-    
+    int lp_type;
+    double z;
+    std::vector<double> soln; // unscaled below
+    if (small) {
+        SmallResult lp;
+        solveSmall(numRules, numVars, A, B.data(), C.data(), lp);
+        lp_type = lp.lp_type;
+        z = lp.z;
+        soln = lp.soln;
+        std::cout << fixed << "Small solver: " << lp.pivots << " pivots in "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - begin)
+                         .count()
+                  << "[µs]" << std::endl;
+    } else if (race) {
+        solveRace(numRules, numVars, A, B, C, lp_type, z, soln);
+    } else if (revised) {
+        RevisedSimplex lp(numRules, numVars, S, B, C,
+                          basisIn ? &start : nullptr);
+        lp_type = lp.lp_type;
+        z = lp.z;
+        soln = lp.soln;
+        final = lp.GetBasis();
+    } else {
+        const Basis *from = basisIn ? &start : nullptr;
+        Basis rough;
+        // The double tableau again, after the float solve.
+        auto refill = [&]() {
+            std::mt19937 again(1);
+            fill(A, again);
+            if (!fromFile && scaleMethod != Scaling::OFF)
+                scaling.apply(A);
+        };
+        if (single) {
+            {
+                Simplex<float> lp(numRules, numVars, F, B, C, from,
+                                  bounded ? &model.bounds : nullptr);
+                rough = lp.GetBasis();
+                if (lp.stopped)
+                    std::cout << "Float solve stopped after " << lp.pivots
+                              << " pivots" << std::endl;
+            }
+            from = &rough;
+            std::cout << "Refining in double precision" << std::endl;
+            refill();
+        }
+        std::unique_ptr<Simplex<double>> tableau;
+        tableau.reset(new Simplex<double>(numRules, numVars, A, B, C, from,
+                                          bounded ? &model.bounds : nullptr));
+        if (single && tableau->lp_type != Simplex<double>::FEASIBLE) {
+            // The float solve's basis can be too ill-conditioned to finish
+            // from; start over from the slack basis.
+            std::cout << "Refinement failed, solving from the slack basis"
+                      << std::endl;
+            refill();
+            tableau.reset(new Simplex<double>(
+                numRules, numVars, A, B, C, basisIn ? &start : nullptr,
+                bounded ? &model.bounds : nullptr));
+        }
+        if (fromFile)
+            model.A = SparseMatrix();
+        lp_type = tableau->lp_type;
+        z = tableau->z;
+        soln = tableau->soln;
+        final = tableau->GetBasis();
+    }
     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    // The problem's own x, from the scaled problem's (scaling.h).
+    scaling.unscale(soln);
 
-    if (lp.lp_type == lp.UNBOUNDED) {
+    if (lp_type == Simplex<double>::UNBOUNDED) {
         std::cout << "unbounded" << std::endl;
-    } else if (lp.lp_type == lp.INFEASIBLE) {
+    } else if (lp_type == Simplex<double>::INFEASIBLE) {
         std::cout << "infeasible" << std::endl;
-    } else if (lp.lp_type == lp.FEASIBLE) {
-        std::cout << "The optimum is " << lp.z << std::endl;
+    } else if (lp_type == Simplex<double>::FEASIBLE) {
+        std::cout << "The optimum is " << (fromFile ? model.objective(z) : z) << std::endl;
         /*
         for (int i = 0; i < numVars; i++) {
             std::cout << "x" << i << " = " << lp.soln[i] << std::endl;
@@ -355,6 +623,10 @@ int main(int argc, char *argv[]) {
     }
 
     std::cout << "Time difference = " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << "[ms]" << std::endl;
+    if (fromFile && lp_type == Simplex<double>::FEASIBLE)
+        reportSolution(mps, presolve.postsolve(model.solution(soln)));
+    if (basisOut && !writeBasis(basisOut, final, model))
+        return 1;
     // std::cout << "Time difference = " << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() << "[µs]" << std::endl;
     // std::cout << "Time difference = " << std::chrono::duration_cast<std::chrono::nanoseconds> (end - begin).count() << "[ns]" << std::endl;
 
@@ -2,114 +2,376 @@
 // adapted from UBC CODERCHIVE 2014).
 // It is in the public domain. --- Carl Kingsford Nov. 2017
 // We got this code from 15-451.
+//
+// Distributed tableau: the m constraint rows are split into contiguous
+// blocks, one per rank, and no rank ever holds the whole tableau.  Every
+// rank keeps its own copy of the objective row and of basic/nonbasic, and
+// updates them identically, so pricing needs no communication.  The ratio
+// tests are MPI_MINLOC allreduces; the owner of the pivot row scales it and
+// broadcasts it, and each rank applies the rank-1 update to its own rows.
+//
+//   mpirun -np N ./simplex-openmpi model.mps
+//   mpirun -np N ./simplex-openmpi m n
 
 #include "mpi.h"
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <random>
 #include <vector>
 
-const static int FEASIBLE = 1; // int vars are ok though
-const static int INFEASIBLE = 0;
-const static int UNBOUNDED = -1;
-const double EPS = 1e-9;
-const double INF = 1e100;
+#include "kernels.h"
+#include "mps.h"
+#include "tableau.h"
 
-int main(int argc, char *argv[]) {
-    int pid;
-    int nproc;
+using namespace std;
 
-    MPI_Init(&argc, &argv);
-    MPI_Comm_rank(MPI_COMM_WORLD, &pid);
-    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+static_assert(sizeof(Compare) == 16, "Compare must match MPI_DOUBLE_INT");
 
-    std::cout << pid << std::endl;
-    if (pid == 0) {
-    int numRules = 20000;
-    int numVars = 20000;
+class Simplex {
 
-    std::vector<std::vector<double>> A;
-    std::vector<double> B;
-    std::vector<double> C;
-    std::vector<int> basic;    // size numRules.  indices of basic vars
-    std::vector<int> nonbasic; // size numVars.  indices of non-basic vars
+  private:
+    int m, n;
+    int rank;
+    std::vector<int> rowStart; // rank k owns rows [rowStart[k], rowStart[k+1])
+    int lo, hi;                // this rank's rows
+    Tableau A; // (hi-lo+1) x (n+1): our constraint rows, then the objective
+    std::vector<int> basic;    // size m.  indices of basic vars
+    std::vector<int> nonbasic; // size n.  indices of non-basic vars
+    std::vector<double> pivotRow;
 
-    std::mt19937 randGen(1);
-    std::uniform_real_distribution<double> randReal(0, 100000.f);
+  public:
+    std::vector<double> soln; // on rank 0
+    double z;    // return value of the objective function.
+    int lp_type; // for return.  1 if feasible, 0 if not feasible, -1 if
+                 // unbounded
 
-    auto randFloat = [&]() { return randReal(randGen); };
+    const double INF;
+    const double EPS;
+    const static int FEASIBLE = 1;
+    const static int INFEASIBLE = 0;
+    const static int UNBOUNDED = -1;
 
-    A.resize(numRules + 1);
-    for (int i = 0; i < numRules + 1; i++) {
-        A[i].resize(numVars + 1);
-    }
-    for (int i = 0; i < numRules; i++) {
-        for (int j = 0; j < numVars; j++) {
-            A[i][j] = randFloat();
+    /*
+      input:
+        m = #constraints, n =#variables
+        max c dot x s.t. a x <= b  x >= 0
+        rowStart0 = the first row of each rank, then m
+        A0 = this rank's rows of a, as a (hi-lo+1) x (n+1) tableau
+        B = this rank's part of b, C = all of c
+      Every rank of MPI_COMM_WORLD must construct one.
+      output:
+        lp_type and z on every rank, soln on rank 0.
+    */
+    Simplex(int m0, int n0, std::vector<int> &rowStart0, Tableau &A0,
+            std::vector<double> &B, std::vector<double> &C)
+        : m(m0), n(n0), rowStart(rowStart0), A(std::move(A0)), basic(m0),
+          nonbasic(n0), pivotRow(n0 + 1), z(0), lp_type(INFEASIBLE),
+          INF(1e100), EPS(1e-9) {
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        lo = rowStart[rank];
+        hi = rowStart[rank + 1];
+
+        for (int j = 0; j < m; j++)
+            basic[j] = n + j;
+        for (int i = 0; i < n; i++)
+            nonbasic[i] = i;
+        for (int i = lo; i < hi; i++)
+            A[i - lo][n] = B[i - lo];
+        for (int j = 0; j < n; j++)
+            A[hi - lo][j] = C[j];
+
+        const kernels::Table &k = kernels::get();
+        double findFeasibility = 0, findX = 0, findConstraint = 0,
+               findPivot = 0;
+        auto micros = [](std::chrono::steady_clock::time_point s) {
+            return (double)std::chrono::duration_cast<
+                       std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - s)
+                .count();
+        };
+
+        auto feasibilityStart = std::chrono::steady_clock::now();
+        // Don't run simplex on an infeasible LP
+        bool isFeasible = Feasible();
+        findFeasibility = micros(feasibilityStart);
+
+        while (isFeasible) {
+            // The objective row is replicated, so every rank picks the same
+            // column without talking to the others.
+            auto xStart = std::chrono::steady_clock::now();
+            Compare max = {0.0, 0};
+            max = k.argmax(A[hi - lo], 0, n, max);
+            int c = max.index;
+            findX += micros(xStart);
+
+            if (max.val < EPS) {
+                Solution();
+                lp_type = FEASIBLE;
+                break;
+            }
+
+            auto constraintStart = std::chrono::steady_clock::now();
+            Compare min = {INF, 0};
+            min = MinLoc(Local(k.minRatio(A[0] + n, A[0] + c, A.stride(), 0,
+                                          hi - lo, EPS, min)));
+            findConstraint += micros(constraintStart);
+
+            if (min.val == INF) {
+                lp_type = UNBOUNDED;
+                break;
+            }
+            auto pivotStart = std::chrono::steady_clock::now();
+            Pivot(min.index, c);
+            findPivot += micros(pivotStart);
+        }
+
+        if (rank == 0) {
+            std::cout << fixed << "Time taken to find feasibility = " << (findFeasibility) << "[microseconds]" << std::endl;
+            std::cout << fixed << "Time taken to find variable to optimize = " << (findX) << "[microseconds]" << std::endl;
+            std::cout << fixed << "Time taken to search constraints to optimize variable = " << (findConstraint) << "[microseconds]" << std::endl;
+            std::cout << fixed << "Time taken to pivot to new vertex on polytope = " << (findPivot) << "[microseconds]" << std::endl;
         }
     }
 
-    B.resize(numRules);
-    for (int i = 0; i < numRules; i++) {
-        B[i] = randFloat();
+  private:
+    int Owner(int r) const {
+        return std::upper_bound(rowStart.begin(), rowStart.end(), r) -
+               rowStart.begin() - 1;
+    }
+
+    // A scan over our rows reports a local index; make it global.
+    Compare Local(Compare c) const {
+        if (c.val != INF)
+            c.index += lo;
+        return c;
+    }
+
+    // The smallest value over all ranks, ties to the lowest row.
+    Compare MinLoc(Compare mine) const {
+        Compare best;
+        MPI_Allreduce(&mine, &best, 1, MPI_DOUBLE_INT, MPI_MINLOC,
+                      MPI_COMM_WORLD);
+        return best;
     }
 
-    C.resize(numVars);
-    for (int i = 0; i < numVars; i++) {
-        C[i] = randFloat();
+    void Pivot(int r, int c) {
+        const kernels::Table &k = kernels::get();
+        int owner = Owner(r);
+
+        // The owner scales row r in place and sends it to everyone else.
+        double *row = pivotRow.data();
+        if (rank == owner) {
+            row = A[r - lo];
+            double inv = 1 / row[c];
+            k.scale(row, inv, c);
+            k.scale(row + c + 1, inv, n - c);
+            row[c] = inv;
+        }
+        MPI_Bcast(row, n + 1, MPI_DOUBLE, owner, MPI_COMM_WORLD);
+        double inv = row[c];
+
+        // Rows 0 .. hi-lo-1 are ours, row hi-lo is the objective.
+        for (int i = 0; i <= hi - lo; i++) {
+            if (i < hi - lo && i + lo == r)
+                continue;
+            double f = A[i][c];
+            if (f != 0) {
+                k.subMul(A[i], f, row, c);
+                k.subMul(A[i] + c + 1, f, row + c + 1, n - c);
+                A[i][c] = -f * inv;
+            }
+        }
+        swap(basic[r], nonbasic[c]);
+    }
+
+    bool Feasible() {
+        const kernels::Table &k = kernels::get();
+        while (true) {
+            Compare min = {INF, 0};
+            min = MinLoc(Local(k.argmin(A[0] + n, A.stride(), 0, hi - lo,
+                                        min)));
+            int r = min.index;
+
+            if (min.val > -EPS)
+                return true;
+
+            // Row r's owner finds its most negative entry and the ratio it
+            // starts the search below from.
+            double pick[3] = {0.0, 0, 0}; // value, column, ratio
+            int owner = Owner(r);
+            if (rank == owner) {
+                Compare col = {0.0, 0};
+                col = k.argmin(A[r - lo], 1, 0, n, col);
+                pick[0] = col.val;
+                pick[1] = col.index;
+                pick[2] = A[r - lo][n] / A[r - lo][col.index];
+            }
+            MPI_Bcast(pick, 3, MPI_DOUBLE, owner, MPI_COMM_WORLD);
+            int c = (int)pick[1];
+
+            if (pick[0] > -EPS)
+                return false;
+
+            Compare below = {INF, 0};
+            int begin = std::max(r + 1, lo) - lo;
+            if (begin < hi - lo)
+                below = Local(k.minRatio(A[0] + n, A[0] + c, A.stride(),
+                                         begin, hi - lo, EPS, below));
+            Compare start = {pick[2], r};
+            min = MinLoc(below.val < start.val ? below : start);
+
+            Pivot(min.index, c);
+        }
     }
 
-    #pragma clang loop interleave(enable)
-    for (int j = 0; j < numRules; j++)
-        basic[j] = numVars + j;
-
-    #pragma clang loop interleave(enable)
-    for (int i = 0; i < numVars; i++)
-        nonbasic[i] = i;
-    
-    #pragma clang loop unroll(enable)
-    for (int i = 0; i < numRules; i++) 
-        A[i][numVars] = B[i];
-
-    // Add c vector to A
-    #pragma clang loop interleave(enable)
-    for (int j = 0; j < numVars; j++)
-        A[numRules][j] = C[j];
-    
-    std::cout << "Loaded" << std::endl;
+    // Gather the right-hand sides to rank 0 and read off the solution.
+    void Solution() {
+        int nproc = rowStart.size() - 1;
+        std::vector<double> mine(hi - lo), rhs(rank == 0 ? m : 0);
+        for (int i = lo; i < hi; i++)
+            mine[i - lo] = A[i - lo][n];
+        std::vector<int> counts(nproc);
+        for (int p = 0; p < nproc; p++)
+            counts[p] = rowStart[p + 1] - rowStart[p];
+        MPI_Gatherv(mine.data(), hi - lo, MPI_DOUBLE, rhs.data(),
+                    counts.data(), rowStart.data(), MPI_DOUBLE, 0,
+                    MPI_COMM_WORLD);
+        z = -A[hi - lo][n];
+        if (rank != 0)
+            return;
+        soln.assign(n, 0.0);
+        for (int i = 0; i < m; i++)
+            if (basic[i] < n)
+                soln[basic[i]] = rhs[i];
     }
+};
+
+int main(int argc, char *argv[]) {
+    int pid;
+    int nproc;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &pid);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+    int numRules, numVars;
 
-    std::vector<std::vector<double>> myA;
-    std::vector<double> myB;
-    std::vector<double> myC;
+    // Every rank reads the (sparse) model and keeps its own rows.
+    StandardForm model;
+    bool fromFile = argc == 2;
+    if (fromFile) {
+        if (!loadStandardForm(argv[1], model)) {
+            MPI_Finalize();
+            return 1;
+        }
+        numRules = model.m;
+        numVars = model.n;
+    } else if (argc == 3) {
+        numRules = atoi(argv[1]);
+        numVars = atoi(argv[2]);
+    } else {
+        if (pid == 0)
+            std::cerr << "usage: " << argv[0] << " model.mps | m n"
+                      << std::endl;
+        MPI_Finalize();
+        return 1;
+    }
 
+    if (pid == 0)
+        std::cout << "Input size is " << numRules << " by " << numVars
+                  << " on " << nproc << " ranks" << std::endl;
 
     // Split these into equal parts by first index (rows)
+    std::vector<int> rowStart(nproc + 1);
+    for (int p = 0; p <= nproc; p++)
+        rowStart[p] = (long)numRules * p / nproc;
+    int lo = rowStart[pid], hi = rowStart[pid + 1];
+
+    Tableau A(hi - lo + 1, numVars + 1);
+    std::vector<double> B(hi - lo);
+    std::vector<double> C(numVars);
+
+    if (fromFile) {
+        for (int i = lo; i < hi; i++) {
+            model.A.scatterRow(i, A[i - lo]);
+            B[i - lo] = model.B[i];
+        }
+        C = model.C;
+        model.A = SparseMatrix();
+    } else {
+        // Rank 0 draws the same problem as the other solvers, in the same
+        // order, and streams each row to its owner.
+        std::mt19937 randGen(1);
+        std::uniform_real_distribution<double> randReal(0, 100000.f);
+
+        auto randFloat = [&]() { return randReal(randGen); };
+
+        if (pid == 0) {
+            std::vector<double> row(numVars);
+            for (int p = 0; p < nproc; p++) {
+                for (int i = rowStart[p]; i < rowStart[p + 1]; i++) {
+                    double *dst = p == 0 ? A[i] : row.data();
+                    for (int j = 0; j < numVars; j++)
+                        dst[j] = randFloat();
+                    if (p != 0)
+                        MPI_Send(dst, numVars, MPI_DOUBLE, p, 0,
+                                 MPI_COMM_WORLD);
+                }
+            }
+        } else {
+            for (int i = lo; i < hi; i++)
+                MPI_Recv(A[i - lo], numVars, MPI_DOUBLE, 0, 0,
+                         MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
 
+        std::vector<double> allB;
+        if (pid == 0) {
+            allB.resize(numRules);
+            for (int i = 0; i < numRules; i++)
+                allB[i] = randFloat();
+            for (int i = 0; i < numVars; i++)
+                C[i] = randFloat();
+        }
+        std::vector<int> counts(nproc);
+        for (int p = 0; p < nproc; p++)
+            counts[p] = rowStart[p + 1] - rowStart[p];
+        MPI_Scatterv(allB.data(), counts.data(), rowStart.data(), MPI_DOUBLE,
+                     B.data(), hi - lo, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        MPI_Bcast(C.data(), numVars, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    }
 
+    if (pid == 0)
+        std::cout << "Loaded" << std::endl;
 
+    MPI_Barrier(MPI_COMM_WORLD);
     std::chrono::steady_clock::time_point begin =
         std::chrono::steady_clock::now();
 
-    // Simplex lp(numRules, numVars, A, B, C);
+    Simplex lp(numRules, numVars, rowStart, A, B, C);
 
     std::chrono::steady_clock::time_point end =
         std::chrono::steady_clock::now();
 
-    // if (lp.lp_type == lp.UNBOUNDED) {
-    //     std::cout << "unbounded" << std::endl;
-    // } else if (lp.lp_type == lp.INFEASIBLE) {
-    //     std::cout << "infeasible" << std::endl;
-    // } else if (lp.lp_type == lp.FEASIBLE) {
-    //     std::cout << "The optimum is " << lp.z << std::endl;
-    // } else {
-    //     std::cout << "Should not have happened" << std::endl;
-    // }
-
-    std::cout << "Time difference = "
-              << std::chrono::duration_cast<std::chrono::milliseconds>(end -
-                                                                       begin)
-                     .count()
-              << "[ms]" << std::endl;
+    if (pid == 0) {
+        if (lp.lp_type == lp.UNBOUNDED) {
+            std::cout << "unbounded" << std::endl;
+        } else if (lp.lp_type == lp.INFEASIBLE) {
+            std::cout << "infeasible" << std::endl;
+        } else if (lp.lp_type == lp.FEASIBLE) {
+            std::cout << "The optimum is "
+                      << (fromFile ? model.objective(lp.z) : lp.z)
+                      << std::endl;
+        } else {
+            std::cout << "Should not have happened" << std::endl;
+        }
+
+        std::cout << "Time difference = "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(
+                         end - begin)
+                         .count()
+                  << "[ms]" << std::endl;
+    }
     MPI_Finalize();
 }
@@ -8,6 +8,8 @@
 #include <random>
 #include <cstdlib>
 
+#include "mps.h"
+
 using namespace std;
 
 class Simplex {
@@ -199,38 +201,56 @@ int main(int argc, char *argv[]) {
     ios_base::sync_with_stdio(false);
     cin.tie(NULL);
     std::vector<std::vector<double>> A;
+    std::vector<double> B;
+    std::vector<double> C;
+    int numRules, numVars;
+
+    // ./simplex-seq model.mps solves a netlib model, ./simplex-seq m n
+    // a random m by n problem.
+    StandardForm model;
+    bool fromFile = argc == 2;
+    if (fromFile) {
+        if (!loadStandardForm(argv[1], model))
+            return 1;
+        numRules = model.m;
+        numVars = model.n;
+        A.assign(numRules, std::vector<double>(numVars));
+        for (int i = 0; i < numRules; i++)
+            model.A.scatterRow(i, A[i].data());
+        model.A = SparseMatrix();
+        B = std::move(model.B);
+        C = std::move(model.C);
+    } else {
+        numRules = atoi(argv[1]);
+        numVars = atoi(argv[2]);
 
-    int numRules = atoi(argv[1]);
-    int numVars = atoi(argv[2]);
-
-    std::mt19937 randGen(1);
-    std::uniform_real_distribution<double>randReal(0, 100000.f);
+        std::mt19937 randGen(1);
+        std::uniform_real_distribution<double>randReal(0, 100000.f);
 
-    auto randFloat = [&](){return randReal(randGen) ;};
+        auto randFloat = [&](){return randReal(randGen) ;};
 
-    A.resize(numRules);
-    for (int i = 0; i < numRules; i++) {
-        A[i].resize(numVars);
-    }
-    for (int i = 0; i < numRules; i++) {
-        for (int j = 0; j < numVars; j++) {
-            // std::cin >> A[i][j];
-            A[i][j] = randFloat();
+        A.resize(numRules);
+        for (int i = 0; i < numRules; i++) {
+            A[i].resize(numVars);
+        }
+        for (int i = 0; i < numRules; i++) {
+            for (int j = 0; j < numVars; j++) {
+                // std::cin >> A[i][j];
+                A[i][j] = randFloat();
+            }
         }
-    }
 
-    std::vector<double> B;
-    B.resize(numRules);
-    for (int i = 0; i < numRules; i++) {
-        // std::cin >> B[i];
-        B[i] = randFloat();
-    }
+        B.resize(numRules);
+        for (int i = 0; i < numRules; i++) {
+            // std::cin >> B[i];
+            B[i] = randFloat();
+        }
 
-    std::vector<double> C;
-    C.resize(numVars);
-    for (int i = 0; i < numVars; i++) {
-        // std::cin >> C[i];
-        C[i] = randFloat();
+        C.resize(numVars);
+        for (int i = 0; i < numVars; i++) {
+            // std::cin >> C[i];
+            C[i] = randFloat();
+        }
     }
     
     std::cout << "Loaded"  << std::endl;
@@ -245,7 +265,7 @@ int main(int argc, char *argv[]) {
     } else if (lp.lp_type == lp.INFEASIBLE) {
         std::cout << "infeasible" << std::endl;
     } else if (lp.lp_type == lp.FEASIBLE) {
-        std::cout << "The optimum is " << lp.z << std::endl;
+        std::cout << "The optimum is " << (fromFile ? model.objective(lp.z) : lp.z) << std::endl;
         // for (int i = 0; i < numVars; i++) {
         //     std::cout << "x" << i << " = " << lp.soln[i] << std::endl;
         // }
@@ -0,0 +1,331 @@
+// Tests of the solver's parts that its output alone doesn't show, run by
+// checker.py: ./simplex-test <test> [args].  Each prints a line per case,
+// "ok" or "FAILED" and what was checked, and exits with status 1 if any
+// case failed.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lu.h"
+#include "mps.h"
+#include "revised.h"
+#include "simplex.h"
+#include "sparse.h"
+#include "tableau.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void report(bool ok, const string &what) {
+    cout << (ok ? "ok      " : "FAILED  ") << what << endl;
+    if (!ok)
+        failures++;
+}
+
+// A nonsingular basis whose sparsest columns are numerically empty: eight
+// two-entry columns below PIVOT_ZERO and four full ones.  Only the eight
+// may be swapped for slacks, and B x = a has to hold for the basis with
+// those swapped.
+static void testFactorSkipsEmptyColumns() {
+    const int m = 12, tiny = 8;
+    mt19937 rng(451);
+    uniform_real_distribution<double> dist(1, 2);
+    vector<vector<BasisFactor::Entry>> cols(m);
+    for (int j = 0; j < tiny; j++) {
+        cols[j].emplace_back(j, 1e-13 * dist(rng));
+        cols[j].emplace_back(j + 1, 1e-13 * dist(rng));
+    }
+    for (int j = tiny; j < m; j++)
+        for (int i = 0; i < m; i++)
+            cols[j].emplace_back(i, (i == j ? 4 : 0) + dist(rng));
+
+    BasisFactor lu;
+    vector<pair<int, int>> replaced;
+    lu.factor(m, cols, replaced);
+    bool onlyEmpty = (int)replaced.size() == tiny;
+    for (auto &pr : replaced)
+        onlyEmpty = onlyEmpty && pr.first < tiny;
+    report(onlyEmpty, "factor: only the " + to_string(tiny) +
+                          " empty columns of a nonsingular basis replaced, " +
+                          to_string(replaced.size()) + " were");
+
+    for (auto &pr : replaced)
+        cols[pr.first].assign(1, BasisFactor::Entry(pr.second, 1.0));
+    vector<double> want(m), a(m, 0.0), x;
+    for (int j = 0; j < m; j++) {
+        want[j] = dist(rng);
+        for (auto &e : cols[j])
+            a[e.first] += e.second * want[j];
+    }
+    lu.ftran(a, x);
+    double err = 0;
+    for (int j = 0; j < m; j++)
+        err = max(err, fabs(x[j] - want[j]));
+    ostringstream what;
+    what << "factor: ftran of that basis, error " << scientific << err;
+    report(err <= 1e-9, what.str());
+}
+
+// The problem a Simplex solves, kept dense alongside it:
+//   max c dot x s.t. 0 <= b - a x <= range  lower <= x <= upper
+struct Problem {
+    std::vector<std::vector<double>> rows;
+    std::vector<double> b, c;
+    Bounds bounds;
+};
+
+// The model at path in the bounded form, or the row form with its bounds
+// as rows (mps.h), as the solver would take it, without presolve or
+// scaling.  False if it can't be read.
+static bool loadProblem(const char *path, bool bounded, Problem &p) {
+    MPSModel mps;
+    if (!loadMPS(path, mps))
+        return false;
+    StandardForm sf;
+    toStandardForm(mps, sf, bounded);
+    p.rows.assign(sf.m, std::vector<double>(sf.n));
+    for (int i = 0; i < sf.m; i++)
+        sf.A.scatterRow(i, p.rows[i].data());
+    p.b = sf.B;
+    p.c = sf.C;
+    p.bounds = sf.bounds;
+    if (!bounded) {
+        p.bounds.lower.assign(sf.n, 0.0);
+        p.bounds.upper.assign(sf.n, INFINITY);
+        p.bounds.range.assign(sf.m, INFINITY);
+    }
+    return true;
+}
+
+// An m by n problem drawn as simplex-openmp draws its random ones.
+static void randomProblem(int m, int n, Problem &p) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> real(0, 100000.f);
+    p.rows.assign(m, std::vector<double>(n));
+    for (auto &row : p.rows)
+        for (auto &v : row)
+            v = real(gen);
+    p.b.resize(m);
+    for (auto &v : p.b)
+        v = real(gen);
+    p.c.resize(n);
+    for (auto &v : p.c)
+        v = real(gen);
+    p.bounds.lower.assign(n, 0.0);
+    p.bounds.upper.assign(n, INFINITY);
+    p.bounds.range.assign(m, INFINITY);
+}
+
+// p solved from scratch by the revised engine (revised.h), which takes
+// only a x <= b, x >= 0: each x_j becomes shift_j + x'_pos - x'_neg as in
+// toStandardForm, and ranges and upper bounds become rows.  Returns
+// lp_type, and sets z when FEASIBLE.
+static int coldSolve(const Problem &p, double &z) {
+    int m = p.rows.size(), n = p.c.size(), cols = 0;
+    std::vector<int> pos(n, -1), neg(n, -1);
+    std::vector<double> shift(n, 0.0), cap, C;
+    double objConst = 0;
+    for (int j = 0; j < n; j++) {
+        double lo = p.bounds.lower[j], up = p.bounds.upper[j];
+        if (std::isfinite(lo)) {
+            shift[j] = lo;
+            pos[j] = cols++;
+            cap.push_back(up - lo);
+            C.push_back(p.c[j]);
+        } else if (std::isfinite(up)) {
+            shift[j] = up;
+            neg[j] = cols++;
+            cap.push_back(INFINITY);
+            C.push_back(-p.c[j]);
+        } else {
+            pos[j] = cols++;
+            neg[j] = cols++;
+            cap.insert(cap.end(), 2, INFINITY);
+            C.push_back(p.c[j]);
+            C.push_back(-p.c[j]);
+        }
+        objConst += p.c[j] * shift[j];
+    }
+    std::vector<Triplet> t;
+    std::vector<double> B;
+    // sign times row i: a x <= b, or -a x <= range - b for its range.
+    auto addRow = [&](int i, double sign, double rhs) {
+        int k = B.size();
+        for (int j = 0; j < n; j++) {
+            double v = sign * p.rows[i][j];
+            if (v == 0)
+                continue;
+            rhs -= v * shift[j];
+            if (pos[j] >= 0)
+                t.push_back({k, pos[j], v});
+            if (neg[j] >= 0)
+                t.push_back({k, neg[j], -v});
+        }
+        B.push_back(rhs);
+    };
+    for (int i = 0; i < m; i++) {
+        addRow(i, 1, p.b[i]);
+        if (std::isfinite(p.bounds.range[i]))
+            addRow(i, -1, p.bounds.range[i] - p.b[i]);
+    }
+    for (int j = 0; j < cols; j++) {
+        if (std::isfinite(cap[j])) {
+            t.push_back({(int)B.size(), j, 1.0});
+            B.push_back(cap[j]);
+        }
+    }
+    int rows = B.size();
+    SparseMatrix S = SparseMatrix::fromTriplets(rows, cols, std::move(t));
+    RevisedSimplex lp(rows, cols, S, B, C, nullptr, true);
+    z = lp.z + objConst;
+    return lp.lp_type;
+}
+
+// k random edits to a solved Simplex, through each of SetRhs, SetCost,
+// SetBounds, AddCut, RemoveRow, AddColumn and RemoveColumn in turn, each
+// followed by a re-solve from the basis before it.  The same edits go to
+// p, and every re-solve has to match a cold solve of p by the revised
+// engine: the same status, and the same optimum.
+static void testEdits(Problem &p, bool bounded, int k, const string &name) {
+    int m = p.rows.size(), n = p.c.size();
+    Tableau T(m + 1, n + 1);
+    for (int i = 0; i < m; i++)
+        std::copy(p.rows[i].begin(), p.rows[i].end(), T[i]);
+    std::vector<double> b(p.b), c(p.c);
+    Simplex<double> lp(m, n, T, b, c, nullptr,
+                       bounded ? &p.bounds : nullptr, true);
+
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> scale(0.95, 1.05);
+    for (int e = 0; e < k; e++) {
+        int em = p.rows.size(), en = p.c.size();
+        int i = gen() % em, j = gen() % en;
+        string what;
+        bool done = false;
+        // Scaled by f, and moved by f - 1 in case it is 0.
+        double f = scale(gen);
+        switch (e % 7) {
+        case 0:
+            p.b[i] = p.b[i] * f + f - 1;
+            done = lp.SetRhs(i, p.b[i]);
+            what = "b" + to_string(i) + " = " + to_string(p.b[i]);
+            break;
+        case 1:
+            p.c[j] = p.c[j] * f + f - 1;
+            done = lp.SetCost(j, p.c[j]);
+            what = "c" + to_string(j) + " = " + to_string(p.c[j]);
+            break;
+        case 2: {
+            // Halve x_j's upper bound, as far as its lower one allows.
+            double x = lp.lp_type == Simplex<double>::FEASIBLE &&
+                               j < (int)lp.soln.size()
+                           ? lp.soln[j]
+                           : 1.0;
+            double lo = p.bounds.lower[j];
+            double up = std::max(lo, std::min(p.bounds.upper[j], x / 2));
+            done = lp.SetBounds(j, lo, up);
+            if (done)
+                p.bounds.upper[j] = up;
+            what = "x" + to_string(j) + " <= " + to_string(up);
+            break;
+        }
+        case 3: {
+            // Row i again, a tenth tighter.
+            double rhs = p.b[i] - std::fabs(p.b[i]) / 10;
+            done = lp.AddCut(p.rows[i], rhs);
+            if (done) {
+                p.rows.push_back(p.rows[i]);
+                p.b.push_back(rhs);
+                p.bounds.range.push_back(INFINITY);
+            }
+            what = "cut on row " + to_string(i);
+            break;
+        }
+        case 4:
+            done = em > 1 && lp.RemoveRow(i);
+            if (done) {
+                p.rows.erase(p.rows.begin() + i);
+                p.b.erase(p.b.begin() + i);
+                p.bounds.range.erase(p.bounds.range.begin() + i);
+            }
+            what = "remove row " + to_string(i);
+            break;
+        case 5: {
+            // Column j again, scaled.
+            std::vector<double> a(em);
+            for (int r = 0; r < em; r++)
+                a[r] = p.rows[r][j] * f;
+            done = lp.AddColumn(a, p.c[j] * f);
+            if (done) {
+                for (int r = 0; r < em; r++)
+                    p.rows[r].push_back(a[r]);
+                p.c.push_back(p.c[j] * f);
+                p.bounds.lower.push_back(0.0);
+                p.bounds.upper.push_back(INFINITY);
+            }
+            what = "add column like " + to_string(j);
+            break;
+        }
+        default:
+            done = en > 1 && lp.RemoveColumn(j);
+            if (done) {
+                for (auto &row : p.rows)
+                    row.erase(row.begin() + j);
+                p.c.erase(p.c.begin() + j);
+                p.bounds.lower.erase(p.bounds.lower.begin() + j);
+                p.bounds.upper.erase(p.bounds.upper.begin() + j);
+            }
+            what = "remove column " + to_string(j);
+            break;
+        }
+        lp.Solve();
+
+        double z = 0;
+        int type = coldSolve(p, z);
+        bool same = type == lp.lp_type &&
+                    (type != Simplex<double>::FEASIBLE ||
+                     std::fabs(z - lp.z) <= 1e-6 * std::max(1.0, std::fabs(z)));
+        ostringstream line;
+        line << name << ", edit " << e + 1 << ": " << what
+             << (done ? "" : " (refused)") << ": status " << lp.lp_type
+             << ", z " << lp.z << " in " << lp.pivots
+             << " pivots; revised from scratch: status " << type << ", z "
+             << z;
+        report(same, line.str());
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        cerr << "usage: " << argv[0] << " lu" << endl;
+        cerr << "       " << argv[0]
+             << " edits bounded|rows k (model.mps | m n)" << endl;
+        return 2;
+    }
+    if (!strcmp(argv[1], "lu")) {
+        testFactorSkipsEmptyColumns();
+    } else if (!strcmp(argv[1], "edits") && (argc == 5 || argc == 6)) {
+        bool bounded = !strcmp(argv[2], "bounded");
+        Problem p;
+        string name = argv[4];
+        if (argc == 6) {
+            randomProblem(atoi(argv[4]), atoi(argv[5]), p);
+            name += " by " + string(argv[5]);
+        } else if (!loadProblem(argv[4], bounded, p)) {
+            return 2;
+        }
+        testEdits(p, bounded, atoi(argv[3]), name);
+    } else {
+        cerr << "unknown test " << argv[1] << endl;
+        return 2;
+    }
+    return failures ? 1 : 0;
+}
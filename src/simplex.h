@@ -0,0 +1,1508 @@
+// The dense tableau simplex, Simplex<T>, that simplex-openmp solves with
+// and simplex-test checks edits on.  Adapted, as the rest of
+// simplex-openmp.cpp, from Danny Sleator's simplex.java.
+
+#ifndef SIMPLEX_H
+#define SIMPLEX_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+#include "basis.h"
+#include "harris.h"
+#include "kernels.h"
+#include "mps.h"
+#include "numa.h"
+#include "pricing.h"
+#include "steal.h"
+#include "tableau.h"
+#include "topk.h"
+
+// Is a a better scan result than b?  Ties go to the lower index, so the
+// winner doesn't depend on how many threads took part.
+inline bool Better(const Compare &a, const Compare &b, bool maximize) {
+    if (a.val == b.val)
+        return a.index < b.index;
+    return maximize ? a.val > b.val : a.val < b.val;
+}
+
+// [lo, hi): this thread's share of [begin, end) in a parallel region
+inline void chunk(int begin, int end, int &lo, int &hi) {
+    int t = omp_get_thread_num(), nt = omp_get_num_threads();
+    lo = begin + (long)(end - begin) * t / nt;
+    hi = begin + (long)(end - begin) * (t + 1) / nt;
+}
+
+// T is the tableau's element type: double, or float for half the memory
+// traffic in Pivot (see simplex-openmp's SIMPLEX_PRECISION).  Everything
+// kept outside the tableau stays double.
+template <class T> class Simplex {
+
+  private:
+    static const bool SINGLE = sizeof(T) < sizeof(double);
+    int m, n;
+    BasicTableau<T> A; // (m+1) x (n+1): constraints, then objective row
+    std::vector<int> basic;    // size m.  indices of basic vars
+    std::vector<int> nonbasic; // size n.  indices of non-basic vars
+    int solvedPivots;          // pivots when the last Solve ended
+
+    // Per-thread scan results for Reduce, two banks of one cache line each.
+    struct Slot {
+        Compare best;
+        char pad[64 - sizeof(Compare)];
+    };
+    std::vector<Slot> slots;
+    // The same for ReduceTop, kept apart so threads don't share lines.
+    struct ListSlot {
+        TopK list;
+        char pad[64];
+    };
+    std::vector<ListSlot> lists;
+
+    // Pricing (pricing.h).  The weights follow the tableau's columns, so a
+    // column's weight passes to whichever variable is nonbasic there.
+    pricing::Rule rule;
+    std::vector<TopK> shortlist; // per thread.  multiple pricing's columns
+    std::vector<double> colWeight; // size n.  devex / steepest edge
+    std::vector<double> rowWeight; // size m.  dual steepest edge
+    std::vector<double> partial;   // steepest: per-thread column sums
+    int partialStride;
+
+    // Ratio test (harris.h).  Column n holds M (b + delta + shifts) for the
+    // row operations M so far: delta is the perturbation (which also raises
+    // the upper bounds of slacks by 2 delta), and Shift raises a slightly
+    // negative b_r to 0.  Restore recomputes M b from b and takes delta off
+    // the bounds again.
+    bool useHarris;
+    std::vector<double> b, cost;
+    std::vector<double> delta;
+    bool shifted;
+    std::vector<T> phase1Cost; // size n.  Phase1's reduced costs
+
+    // Bounds: variable v (x_v for v < n, then the slacks) lies in
+    // [lower[v], upper[v]], and the tableau works with x~_v = x_v - Base(v)
+    // times Sign(v), so that every nonbasic x~_v sits at 0 and can only
+    // increase.  atUpper[v] says Base(v) is the upper bound (or, for a free
+    // variable, that x~_v = -x_v).  Column n is then M (b - a base,
+    // -c base), and Flip moves a nonbasic variable to its other bound.
+    // rowLower and rowUpper are the bounds on x~ of each row's basic
+    // variable: 0 or -INFINITY (free), and the range.
+    std::vector<double> lower, upper;
+    std::vector<char> atUpper;
+    std::vector<double> rowLower, rowUpper;
+    bool boxed;   // some variable has a finite range or none at all
+    bool anyFree; // some variable has no bounds
+    std::vector<int> flipList; // columns for Flip, shared by the team
+
+  public:
+    std::vector<double> soln;
+    double z;    // return value of the objective function.
+    int lp_type; // for return.  1 if feasible, 0 if not feasible, -1 if
+                 // unbounded
+
+    const double INF; // unbelivably, C++ doesn't support static doubles
+                      // initialized in a class
+    // Tolerances: a float tableau's round-off is about 1e-7 relative, so
+    // its own are wider.
+    const double EPS, FEAS_TOL, PIVOT_TOL;
+    int pivots;  // number of Pivot calls, Feasible()'s included
+    // Pivots made before the last Solve to put its start in place:
+    // Install's for start, or RemoveRow's and RemoveColumn's since the
+    // Solve before.  Not in pivots.
+    int installPivots;
+    int flips;   // number of bound flips
+    // A float tableau's round-off can leave it cycling, so its Solve stops
+    // (INFEASIBLE, stopped set) after 2 (m + n) pivots and flips; its basis
+    // is only a start for a double one.
+    bool stopped;
+    // Print nothing: no timings or counts after each Solve (batch mode).
+    bool quiet;
+    // Once set, Solve stops at the next pivot (INFEASIBLE, stopped set):
+    // race mode's loser.  Null for none.
+    const std::atomic<bool> *cancel;
+    const static int FEASIBLE = 1; // int vars are ok though
+    const static int INFEASIBLE = 0;
+    const static int UNBOUNDED = -1;
+
+    // Pivot updates the tableau in tiles of PIVOT_TILE_ROWS x PIVOT_TILE_COLS
+    // (256KB, half a typical L2), so the slice of the pivot row a tile uses
+    // stays in L1 while the tile's rows stream past it.  Shorter tiles
+    // when there are too few rows to give each thread STEAL_TILES of them,
+    // so there is something left to steal (steal.h).
+    static constexpr int PIVOT_TILE_ROWS = 32;
+    static constexpr int PIVOT_TILE_COLS = 1024;
+    static constexpr int STEAL_TILES = 4;
+
+    // Rows per tile of an m-row tableau for a team of nt; public so the
+    // tableau can be placed by tile (numa.h).
+    static int TileRows(int m, int nt) {
+        int rows = (m + STEAL_TILES * nt) / (STEAL_TILES * nt);
+        return std::max(1, std::min(PIVOT_TILE_ROWS, rows));
+    }
+
+    /*
+      input:
+        m = #constraints, n =#variables
+        max c dot x s.t. a x <= b  x >= 0
+        where a = mxn, b = m vector, c = n vector
+        or, given bounds (mps.h),
+        max c dot x s.t. 0 <= b - a x <= range  lower <= x <= upper
+        where lower may be -INFINITY and upper and range INFINITY.
+      output:
+        Infeasible, or Unbounded, or a pair Feasible (z,soln) where z is
+        the maximum objective function value, and soln is an n-vector of
+        variable values.  GetBasis() is the final basis, which can be
+        passed as start to begin a similar problem from it.  quiet turns
+        off the report on stdout, and cancel stops the solve early.
+      caveats:
+        With SIMPLEX_RATIO=textbook cycling is possible.  Beyond
+        recomputing row m before declaring optimality, nothing is done to
+        mitigate loss of precision when the number of iterations is large.
+    */
+    Simplex(int m0, int n0, BasicTableau<T> &A0, std::vector<double> &B,
+            std::vector<double> &C, const Basis *start = nullptr,
+            const Bounds *bounds = nullptr, bool quiet = false,
+            const std::atomic<bool> *cancel = nullptr)
+        : m(m0), n(n0), A(std::move(A0)), basic(m0), nonbasic(n0), soln(n), INF(1e100),
+          EPS(SINGLE ? 1e-6 : 1e-9),
+          FEAS_TOL(SINGLE ? 1e-5 : harris::FEAS_TOL),
+          PIVOT_TOL(SINGLE ? 1e-5 : harris::PIVOT_TOL), quiet(quiet),
+          cancel(cancel)
+
+    {
+        // A = std::move(A0);
+        // m constraints, n variables here
+
+        // Create constraint matrix, resize to add the B matrix as the last column
+        // #pragma omp parallel
+        // {
+            // #pragma clang loop vectorize(enable)
+            #pragma clang loop interleave(enable)
+            for (int j = 0; j < m; j++)
+                basic[j] = n + j;
+
+            // #pragma clang loop vectorize(enable)
+            #pragma clang loop interleave(enable)
+            for (int i = 0; i < n; i++)
+                nonbasic[i] = i;
+            
+            // # pragma omp parallel for
+            #pragma clang loop unroll(enable)
+            // #pragma clang loop interleave(enable)
+            for (int i = 0; i < m; i++) 
+                A[i][n] = B[i];
+
+            // Add c vector to A
+            // #pragma omp parallel for
+            #pragma clang loop interleave(enable)
+            for (int j = 0; j < n; j++)
+                A[m][j] = C[j];
+        // }
+
+        slots.resize(2 * omp_get_max_threads());
+        lists.resize(2 * omp_get_max_threads());
+        shortlist.resize(omp_get_max_threads());
+        tiles = TileQueue(omp_get_max_threads());
+        rule = pricing::fromEnv();
+        colWeight.assign(n, 1.0);
+        rowWeight.assign(m, 1.0);
+        Resized();
+        useHarris = harris::enabled();
+        shifted = false;
+        b = B;
+        cost = C;
+        lower.assign(n + m, 0.0);
+        upper.assign(n + m, INFINITY);
+        atUpper.assign(n + m, 0);
+        rowLower.assign(m, 0.0);
+        rowUpper.assign(m, INFINITY);
+        if (bounds) {
+            for (int j = 0; j < n; j++)
+                Bound(j, bounds->lower[j], bounds->upper[j]);
+            for (int i = 0; i < m; i++)
+                Bound(n + i, 0, bounds->range[i]);
+        }
+        if (useHarris) {
+            // A slack's upper bound goes up by as much again, so an equality
+            // row only loosens too.
+            delta = harris::perturbation(A[0] + n, A.stride(), m);
+            for (int i = 0; i < m; i++) {
+                A[i][n] += delta[i];
+                if (std::isfinite(upper[n + i])) {
+                    upper[n + i] += 2 * delta[i];
+                    RowBounds(i);
+                }
+            }
+        }
+        pivots = solvedPivots = 0;
+        if (start) {
+            int placed = 0, wanted = 0;
+            for (int v : start->basic)
+                wanted += v < n;
+            #pragma omp parallel
+            {
+                int bank = 0;
+                int k = Install(*start, bank);
+                if (omp_get_thread_num() == 0)
+                    placed = k;
+            }
+            if (!quiet)
+                std::cout << "Warm start: " << placed << " of " << wanted
+                          << " basic columns placed" << std::endl;
+        }
+        Solve();
+    }
+
+    Basis GetBasis() const {
+        Basis basis;
+        basis.m = m;
+        basis.n = n;
+        basis.basic = basic;
+        for (int v : nonbasic)
+            if (atUpper[v] && std::isfinite(upper[v]))
+                basis.upper.push_back(v);
+        return basis;
+    }
+
+    // The rows' dual values at the optimum: y_i is minus row m's entry for
+    // row i's slack, the price of one more unit of b_i, or 0 if that slack
+    // is basic.  Race mode takes the primal's x from the dual's.
+    std::vector<double> Duals() const {
+        std::vector<double> y(m, 0.0);
+        for (int j = 0; j < n; j++)
+            if (nonbasic[j] >= n)
+                y[nonbasic[j] - n] = -Sign(nonbasic[j]) * A[m][j];
+        return y;
+    }
+
+    // Solve from the current tableau: the slack basis the first time, and
+    // after AddCut, the previous optimal basis.  A dual feasible tableau
+    // (row m <= 0) is taken to primal feasibility by dual simplex, anything
+    // else by phase 1; then primal simplex finishes.
+    void Solve() {
+        double findFeasibility = 0, findX = 0, findConstraint = 0,
+               findPivot = 0;
+        lp_type = INFEASIBLE;
+        installPivots = pivots - solvedPivots;
+        pivots = 0;
+        flips = 0;
+        stopped = false;
+        boxed = anyFree = false;
+        for (int v = 0; v < n + m; v++) {
+            anyFree |= Free(v);
+            boxed |= std::isfinite(upper[v] - lower[v]);
+        }
+        boxed |= anyFree;
+        // The textbook test for models with no bounds to flip at.
+        const double feasTol = useHarris ? FEAS_TOL : EPS;
+        const double pivotTol = useHarris ? PIVOT_TOL : EPS;
+
+        // One team runs every iteration.  The threads agree on each pivot
+        // through Reduce and only meet at barriers, rather than launching a
+        // new team for every scan and every Pivot.
+        #pragma omp parallel
+        {
+            const kernels::Kernels<T> &k = kernels::get<T>();
+            bool master = omp_get_thread_num() == 0;
+            int bank = 0;
+            int segment = 0; // partial pricing
+            int lo, hi;
+            int refreshed = -1; // pivots + flips when row m was recomputed
+
+            auto feasibilityStart = std::chrono::steady_clock::now();
+            // Don't run simplex on an infeasible LP
+            bool isFeasible;
+            if (DualFeasible(bank)) {
+                isFeasible = Dual(bank);
+                if (isFeasible)
+                    InitWeights();
+            } else if (useHarris || boxed) {
+                isFeasible = Phase1(bank, segment);
+            } else {
+                isFeasible = Feasible(bank);
+                if (isFeasible)
+                    InitWeights();
+            }
+            auto feasibilityEnd = (std::chrono::steady_clock::now());
+            if (master)
+                findFeasibility = std::chrono::duration_cast<std::chrono::microseconds>(feasibilityEnd - feasibilityStart).count();
+
+            while (isFeasible && !OutOfPivots()) {
+                int r = 0, c = 0;
+                double p = 0.0;
+
+                auto xStart = std::chrono::steady_clock::now();
+                if (anyFree)
+                    Orient(A[m], 1.0);
+                struct Compare max = Price(A[m], bank, segment);
+                p = max.val; 
+                c = max.index;
+                auto xEnd = std::chrono::steady_clock::now();
+                if (master)
+                    findX += std::chrono::duration_cast<std::chrono::microseconds>(xEnd - xStart).count();
+
+                if (p < EPS && (!delta.empty() || shifted)) {
+                    // Optimal for the perturbed or shifted b.  Going back to
+                    // b leaves the reduced costs alone but may make some
+                    // basic variables negative; if so, Phase1 repairs them
+                    // and we carry on from there.
+                    auto cleanupStart = std::chrono::steady_clock::now();
+                    Restore();
+                    isFeasible = Phase1(bank, segment);
+                    if (master)
+                        findFeasibility += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - cleanupStart).count();
+                    continue;
+                }
+
+                if (p < EPS && refreshed != pivots + flips) {
+                    // Row m has drifted with every pivot: recompute it from
+                    // cost before believing it.
+                    refreshed = pivots + flips;
+                    Costs();
+                    continue;
+                }
+
+                if (p < EPS) {
+                    #pragma omp for
+                    for (int j = 0; j < n; j++)
+                        if (nonbasic[j] < n)
+                            soln[nonbasic[j]] = Base(nonbasic[j]);
+
+                    # pragma omp for
+                    for (int i = 0; i < m; i++)
+                        if (basic[i] < n)
+                            soln[basic[i]] = Base(basic[i]) +
+                                             Sign(basic[i]) * A[i][n];
+
+                    if (master) {
+                        z = -A[m][n];
+                        lp_type = FEASIBLE;
+                    }
+                    break;
+                }
+
+                p = INF;
+                
+                struct Compare min;
+                min.val = p;
+                min.index = r;
+
+                auto constraintStart = std::chrono::steady_clock::now();
+                chunk(0, m, lo, hi);
+                if (useHarris || boxed) {
+                    TopK steps(RATIO_ROWS, false);
+                    min = Reduce(harris::bound(A[0] + n, A[0] + c, A.stride(),
+                                               rowLower.data(),
+                                               rowUpper.data(), lo, hi,
+                                               pivotTol, feasTol, min,
+                                               useHarris ? &steps : nullptr),
+                                 false, bank);
+                    p = min.val;
+                    if (useHarris && min.val != INF)
+                        min = Pick(c, lo, hi, pivotTol, feasTol, min.val,
+                                   steps, bank);
+                } else {
+                    min = Reduce(k.minRatio(A[0] + n, A[0] + c, A.stride(),
+                                            lo, hi, EPS, min),
+                                 false, bank);
+                    p = min.val;
+                }
+                r = min.index;
+                auto constraintEnd = std::chrono::steady_clock::now();
+                if (master)
+                    findConstraint += std::chrono::duration_cast<std::chrono::microseconds>(constraintEnd - constraintStart).count();
+
+                auto pivotStart = std::chrono::steady_clock::now();
+                // The entering variable reaches its own upper bound first:
+                // flip it there, with no pivot.
+                if (upper[nonbasic[c]] - lower[nonbasic[c]] <= p) {
+                    Flip(std::vector<int>(1, c));
+                    if (master)
+                        findPivot += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - pivotStart).count();
+                    continue;
+                }
+                if (p == INF) {
+                    if (master)
+                        lp_type = UNBOUNDED;
+                    break;
+                }
+                if (boxed)
+                    LeaveRow(r, c, feasTol);
+                if (useHarris)
+                    Shift(r, c);
+                Pivot(r, c, false);
+                auto pivotEnd = std::chrono::steady_clock::now();
+                if (master)
+                    findPivot += std::chrono::duration_cast<std::chrono::microseconds>(pivotEnd - pivotStart).count();
+            }
+        }
+
+        solvedPivots = pivots;
+        if (quiet)
+            return;
+        std::cout << std::fixed << "Time taken to find feasibility = " << (findFeasibility) << "[microseconds]" << std::endl;
+        std::cout << std::fixed << "Time taken to find variable to optimize = " << (findX) << "[microseconds]" << std::endl;
+        std::cout << std::fixed << "Time taken to search constraints to optimize variable = " << (findConstraint) << "[microseconds]" << std::endl;
+        std::cout << std::fixed << "Time taken to pivot to new vertex on polytope = " << (findPivot) << "[microseconds]" << std::endl;
+        std::cout << "Pivots (" << pricing::name(rule) << " pricing) = " << pivots << std::endl;
+        if (installPivots)
+            std::cout << "Install pivots = " << installPivots << std::endl;
+        if (boxed)
+            std::cout << "Bound flips = " << flips << std::endl;
+    }
+
+    // Add the constraint a x <= rhs (a has n entries) to the tableau, in
+    // terms of the current basis, with its slack basic.  Row m is untouched,
+    // so an optimal basis stays dual feasible and Solve() re-optimizes with
+    // a few dual pivots.  Tightening a bound x_j <= u is the cut e_j x <= u.
+    // False if a is the wrong size.
+    bool AddCut(const std::vector<double> &a, double rhs) {
+        if ((int)a.size() != n)
+            return false;
+        const kernels::Kernels<T> &k = kernels::get<T>();
+        A.resizeRows(m + 2);
+        memcpy(A[m + 1], A[m], (n + 1) * sizeof(T));
+
+        // a x in terms of x~ (each x_v is Base(v) + Sign(v) x~_v), with each
+        // basic x~_i replaced by row i's A[i][n] - A[i] x~_N
+        T *row = A[m];
+        row[n] = rhs;
+        for (int v = 0; v < n; v++)
+            row[n] -= a[v] * Base(v);
+        for (int j = 0; j < n; j++)
+            row[j] = nonbasic[j] < n ? a[nonbasic[j]] * Sign(nonbasic[j]) : 0;
+        for (int i = 0; i < m; i++)
+            if (basic[i] < n && a[basic[i]] != 0)
+                k.subMul(row, a[basic[i]] * Sign(basic[i]), A[i], n + 1);
+
+        basic.push_back(n + m);
+        lower.push_back(0);
+        upper.push_back(INFINITY);
+        atUpper.push_back(0);
+        rowLower.push_back(0);
+        rowUpper.push_back(INFINITY);
+        b.push_back(rhs);
+        if (!delta.empty())
+            delta.push_back(0);
+        rowWeight.push_back(1.0 + pricing::sumSquares(row, n));
+        if (rule == pricing::STEEPEST)
+            for (int j = 0; j < n; j++)
+                colWeight[j] += row[j] * row[j];
+        m++;
+        return true;
+    }
+
+    // The edits below keep the tableau in step with the current basis, so
+    // the next Solve() starts from it: a few primal pivots after a cost
+    // change, dual ones after a right-hand side change.  Variables and rows
+    // are numbered as in the model; removing one renumbers those after it.
+    // Each returns false, changing nothing, for an index out of range.
+
+    // c_j = value.  Row m is c~ - c~_B (the tableau), where c~_j is
+    // Sign(j) c_j, so only entry j moves if x_j is nonbasic, and row m
+    // shifts by row r if x_j is basic in row r.  Column n's -c base moves
+    // with Base(j).
+    bool SetCost(int j, double value) {
+        if (j < 0 || j >= n)
+            return false;
+        double d = value - cost[j];
+        cost[j] = value;
+        int r, q;
+        Locate(j, r, q);
+        if (q >= 0)
+            A[m][q] += d * Sign(j);
+        else
+            kernels::get<T>().subMul(A[m], d * Sign(j), A[r], n + 1);
+        A[m][n] -= d * Base(j);
+        return true;
+    }
+
+    // b_i = value.  Column n is M (b - a base, -c base), and M e_i is
+    // Sign(n + i) times the column of row i's slack if it is nonbasic, or
+    // the unit vector of its row if basic.
+    bool SetRhs(int i, double value) {
+        if (i < 0 || i >= m)
+            return false;
+        double d = (value - b[i]) * Sign(n + i);
+        b[i] = value;
+        int r, q;
+        Locate(n + i, r, q);
+        if (q < 0) {
+            A[r][n] += d;
+        } else {
+            for (int k = 0; k <= m; k++)
+                A[k][n] += d * A[k][q];
+        }
+        return true;
+    }
+
+    // lo <= x_j <= up, where lo may be -INFINITY and up INFINITY.  A
+    // nonbasic x_j moves to the new bound on the side it was at, or the one
+    // it has; a basic one keeps its value, and Solve() repairs it if that
+    // is now out of bounds.  False, changing nothing, if lo > up.
+    bool SetBounds(int j, double lo, double up) {
+        if (j < 0 || j >= n || !(lo <= up) || lo == INFINITY ||
+            up == -INFINITY)
+            return false;
+        Bound(j, lo, up);
+        return true;
+    }
+
+    // Drop constraint i.  Its slack is pivoted into the basis (onto the row
+    // with the largest entry in its column) if it isn't already, and then
+    // its row says nothing and goes.
+    bool RemoveRow(int i) {
+        if (i < 0 || i >= m)
+            return false;
+        int r, q;
+        Locate(n + i, r, q);
+        if (q >= 0) {
+            r = 0;
+            for (int k = 1; k < m; k++)
+                if (std::fabs(A[k][q]) > std::fabs(A[r][q]))
+                    r = k;
+            if (A[r][q] == 0)
+                return false;
+            PivotTeam(r, q);
+        }
+        // Row m - 1 moves into r, and the objective row into m - 1.
+        if (r != m - 1) {
+            memcpy(A[r], A[m - 1], (n + 1) * sizeof(T));
+            basic[r] = basic[m - 1];
+            rowWeight[r] = rowWeight[m - 1];
+            rowLower[r] = rowLower[m - 1];
+            rowUpper[r] = rowUpper[m - 1];
+        }
+        memcpy(A[m - 1], A[m], (n + 1) * sizeof(T));
+        basic.pop_back();
+        rowWeight.pop_back();
+        rowLower.pop_back();
+        rowUpper.pop_back();
+        m--;
+        A.resizeRows(m + 1);
+
+        Renumber(n + i, -1);
+        b.erase(b.begin() + i);
+        if (!delta.empty())
+            delta.erase(delta.begin() + i);
+        lower.erase(lower.begin() + n + i);
+        upper.erase(upper.begin() + n + i);
+        atUpper.erase(atUpper.begin() + n + i);
+        return true;
+    }
+
+    // Add variable x_n >= 0 with column a (m entries) and cost c, nonbasic.
+    // Its tableau column is M (a, c), built from the slack columns as in
+    // SetRhs.
+    bool AddColumn(const std::vector<double> &a, double c) {
+        if ((int)a.size() != m)
+            return false;
+        std::vector<double> col(m + 1, 0.0);
+        col[m] = c;
+        for (int i = 0; i < m; i++) {
+            if (a[i] == 0)
+                continue;
+            int r, q;
+            Locate(n + i, r, q);
+            double ai = a[i] * Sign(n + i);
+            if (q < 0) {
+                col[r] += ai;
+            } else {
+                for (int k = 0; k <= m; k++)
+                    col[k] += ai * A[k][q];
+            }
+        }
+        A.resizeCols(n + 2);
+        for (int k = 0; k <= m; k++) {
+            A[k][n + 1] = A[k][n];
+            A[k][n] = col[k];
+        }
+
+        Renumber(n, 1);
+        nonbasic.push_back(n);
+        cost.push_back(c);
+        colWeight.push_back(1.0);
+        lower.insert(lower.begin() + n, 0.0);
+        upper.insert(upper.begin() + n, INFINITY);
+        atUpper.insert(atUpper.begin() + n, 0);
+        n++;
+        Resized();
+        return true;
+    }
+
+    // Drop x_j, as if fixed at 0.  If it is basic it is pivoted out first,
+    // on the largest entry of its row.
+    bool RemoveColumn(int j) {
+        if (j < 0 || j >= n)
+            return false;
+        int r, q;
+        Locate(j, r, q);
+        if (q < 0) {
+            q = 0;
+            for (int k = 1; k < n; k++)
+                if (std::fabs(A[r][k]) > std::fabs(A[r][q]))
+                    q = k;
+            if (A[r][q] == 0)
+                return false;
+            PivotTeam(r, q);
+        }
+        Bound(j, 0, 0);
+        // Column n - 1 moves into q, and the right-hand side into n - 1.
+        for (int k = 0; k <= m; k++) {
+            A[k][q] = A[k][n - 1];
+            A[k][n - 1] = A[k][n];
+        }
+        nonbasic[q] = nonbasic[n - 1];
+        colWeight[q] = colWeight[n - 1];
+        nonbasic.pop_back();
+        colWeight.pop_back();
+        n--;
+        A.resizeCols(n + 1);
+
+        Renumber(j, -1);
+        cost.erase(cost.begin() + j);
+        lower.erase(lower.begin() + j);
+        upper.erase(upper.begin() + j);
+        atUpper.erase(atUpper.begin() + j);
+        Resized();
+        return true;
+    }
+
+  private:
+    // Where variable v is: basic in row r (q = -1) or nonbasic in column q
+    // (r = -1).
+    void Locate(int v, int &r, int &q) const {
+        r = q = -1;
+        for (int k = 0; k < m && r < 0; k++)
+            if (basic[k] == v)
+                r = k;
+        for (int k = 0; k < n && r < 0 && q < 0; k++)
+            if (nonbasic[k] == v)
+                q = k;
+    }
+
+    // Add d to every variable number >= v, as variable v comes or goes.
+    void Renumber(int v, int d) {
+        for (int &k : basic)
+            if (k >= v)
+                k += d;
+        for (int &k : nonbasic)
+            if (k >= v)
+                k += d;
+    }
+
+    // Resize what follows n after a column comes or goes.
+    void Resized() {
+        soln.resize(n);
+        phase1Cost.resize(n);
+        partialStride = (n + Tableau::ROW_ALIGN - 1) / Tableau::ROW_ALIGN *
+                        Tableau::ROW_ALIGN;
+        if (rule == pricing::STEEPEST)
+            partial.assign((size_t)omp_get_max_threads() * partialStride, 0.0);
+    }
+
+    // Pivot from outside a parallel region.
+    void PivotTeam(int r, int q) {
+        #pragma omp parallel
+        Pivot(r, q, false);
+    }
+
+    // x_v where x~_v = 0, and x~_v's sign in x_v.
+    double Base(int v) const {
+        double bound = atUpper[v] ? upper[v] : lower[v];
+        return std::isfinite(bound) ? bound : 0;
+    }
+    double Sign(int v) const { return atUpper[v] ? -1 : 1; }
+    bool Free(int v) const {
+        return !std::isfinite(lower[v]) && !std::isfinite(upper[v]);
+    }
+
+    // rowLower and rowUpper for row i's basic variable.
+    void RowBounds(int i) {
+        int v = basic[i];
+        rowLower[i] = Free(v) ? -INFINITY : 0;
+        rowUpper[i] = upper[v] - lower[v];
+    }
+
+    // Set variable v's bounds.  A nonbasic x_v stays at the bound on the
+    // side it was (or moves to the one it has), which moves column n by
+    // the change in base times M's column for v: Sign(v) times its tableau
+    // column, or the unit vector of its row if basic.  A side change
+    // negates that column, or row.
+    void Bound(int v, double lo, double up) {
+        int r, q;
+        Locate(v, r, q);
+        double base = Base(v), sign = Sign(v);
+        lower[v] = lo;
+        upper[v] = up;
+        if (std::isfinite(lo) != std::isfinite(up))
+            atUpper[v] = std::isfinite(up);
+        double d = (Base(v) - base) * sign;
+        bool negate = Sign(v) != sign;
+        if (q >= 0) {
+            for (int k = 0; k <= m; k++) {
+                A[k][n] -= d * A[k][q];
+                if (negate)
+                    A[k][q] = -A[k][q];
+            }
+        } else {
+            A[r][n] -= d;
+            if (negate)
+                for (int k = 0; k <= n; k++)
+                    A[r][k] = -A[r][k];
+            RowBounds(r);
+        }
+    }
+
+    void printa() {
+        int i, j;
+        for (i = 0; i <= m; i++) {
+            for (j = 0; j <= n; j++) {
+                printf("A[%d][%d] = %f\n", i, j, A[i][j]);
+            };
+        }
+    }
+
+    TileQueue tiles;
+
+    // Combine each thread's scan result.  Every thread publishes its own and,
+    // after one barrier, folds all of them in the same order, so they all
+    // agree on the winner.  Banks alternate so the next scan can't overwrite
+    // slots another thread is still reading.
+    Compare Reduce(Compare mine, bool maximize, int &bank) {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        Slot *s = &slots[bank * nt];
+        bank ^= 1;
+        s[t].best = mine;
+        #pragma omp barrier
+        Compare best = s[0].best;
+        for (int i = 1; i < nt; i++)
+            if (Better(s[i].best, best, maximize))
+                best = s[i].best;
+        return best;
+    }
+
+    // Reduce for TopK: the k best of all the threads' lists, best first,
+    // the same list in every thread.
+    TopK ReduceTop(const TopK &mine, int &bank) {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        ListSlot *s = &lists[bank * nt];
+        bank ^= 1;
+        s[t].list = mine;
+        #pragma omp barrier
+        TopK all = s[0].list;
+        for (int i = 1; i < nt; i++)
+            all.merge(s[i].list);
+        all.sort();
+        return all;
+    }
+
+    // The Harris test's shortest steps kept from pass 1, per thread, for
+    // Pick.
+    static const int RATIO_ROWS = 8;
+
+    // Harris pass 2 for column c, blocking by limit: from the rows pass 1
+    // kept in steps when they are all the rows that block, else by another
+    // pass over [lo, hi), this thread's rows.
+    Compare Pick(int c, int lo, int hi, double pivotTol, double feasTol,
+                 double limit, const TopK &steps, int &bank) {
+        Compare none = {0.0, 0};
+        TopK all = ReduceTop(steps, bank);
+        if (harris::pickFrom(all, A[0] + c, A.stride(), limit, none))
+            return none;
+        return Reduce(harris::pick(A[0] + n, A[0] + c, A.stride(),
+                                   rowLower.data(), rowUpper.data(), lo, hi,
+                                   pivotTol, feasTol, limit, none),
+                      true, bank);
+    }
+
+    // Partial pricing scans segments of at least PARTIAL_MIN columns, at
+    // most PARTIAL_SEGMENTS of them.
+    static constexpr int PARTIAL_SEGMENTS = 8;
+    static constexpr int PARTIAL_MIN = 1024;
+
+    // The entering column for reduced costs d (row m, or Phase1's) and its
+    // reduced cost, or a reduced cost below EPS when there is none.
+    Compare Price(const T *d, int &bank, int &segment) {
+        const kernels::Kernels<T> &k = kernels::get<T>();
+        Compare none = {0.0, 0};
+        int lo, hi;
+        switch (rule) {
+        case pricing::PARTIAL: {
+            int len = std::max(PARTIAL_MIN,
+                               (n + PARTIAL_SEGMENTS - 1) / PARTIAL_SEGMENTS);
+            int count = (n + len - 1) / len;
+            for (int s = 0; s < count; s++) {
+                int g = (segment + s) % count;
+                chunk(g * len, std::min(n, (g + 1) * len), lo, hi);
+                Compare best = Reduce(k.argmax(d, lo, hi, none), true, bank);
+                if (best.val >= EPS) {
+                    segment = (g + 1) % count;
+                    return best;
+                }
+            }
+            return none;
+        }
+        case pricing::MULTIPLE: {
+            // d is current whenever Price runs, so the last scan's columns
+            // are priced again as they are now.
+            TopK &list = shortlist[omp_get_thread_num()];
+            Compare best = none;
+            for (const Compare &e : list)
+                if (d[e.index] > best.val)
+                    best = {(double)d[e.index], e.index};
+            if (best.val >= EPS)
+                return best;
+            chunk(0, n, lo, hi);
+            TopK mine(pricing::MULTIPLE_COLUMNS, true);
+            for (int j = lo; j < hi; j++)
+                if (d[j] >= EPS)
+                    mine.offer(d[j], j);
+            list = ReduceTop(mine, bank);
+            return list.empty() ? none : list[0];
+        }
+        case pricing::DEVEX:
+        case pricing::STEEPEST: {
+            chunk(0, n, lo, hi);
+            Compare best = Reduce(pricing::argmaxWeighted(d, colWeight.data(),
+                                                          lo, hi, EPS, none),
+                                  true, bank);
+            if (best.val > 0)
+                best.val = d[best.index];
+            return best;
+        }
+        default:
+            chunk(0, n, lo, hi);
+            return Reduce(k.argmax(d, lo, hi, none), true, bank);
+        }
+    }
+
+    // Reference weights for phase 2: Devex starts a fresh reference
+    // framework, steepest edge takes the exact column norms.
+    void InitWeights() {
+        if (rule == pricing::DEVEX) {
+            #pragma omp for
+            for (int j = 0; j < n; j++)
+                colWeight[j] = 1.0;
+        } else if (rule == pricing::STEEPEST) {
+            double *mine = &partial[omp_get_thread_num() * partialStride];
+            std::fill(mine, mine + n, 0.0);
+            #pragma omp for schedule(static)
+            for (int i = 0; i < m; i++)
+                pricing::addSquares(mine, A[i], n);
+            SumPartials();
+        }
+    }
+
+    // colWeight = 1 + the per-thread column sums of squares.
+    void SumPartials() {
+        int nt = omp_get_num_threads();
+        #pragma omp for schedule(static)
+        for (int j = 0; j < n; j++) {
+            double s = 1.0;
+            for (int t = 0; t < nt; t++)
+                s += partial[t * partialStride + j];
+            colWeight[j] = s;
+        }
+    }
+
+    // Recompute column n as M (b - a base, -c base): the sum over the
+    // variables of Rhs(v) times the tableau column of v if it is nonbasic,
+    // or the unit vector of its row if basic.
+    void Restore() {
+        if (omp_get_thread_num() == 0 && !delta.empty()) {
+            for (int i = 0; i < m; i++)
+                if (std::isfinite(upper[n + i]))
+                    upper[n + i] -= 2 * delta[i];
+            for (int i = 0; i < m; i++)
+                RowBounds(i);
+        }
+        #pragma omp barrier
+        std::vector<std::pair<int, double>> cols; // (column, Rhs)
+        for (int j = 0; j < n; j++)
+            if (Rhs(nonbasic[j]) != 0)
+                cols.emplace_back(j, Rhs(nonbasic[j]));
+        #pragma omp for
+        for (int i = 0; i <= m; i++) {
+            double s = i < m ? Rhs(basic[i]) : 0;
+            for (auto &cb : cols)
+                s += cb.second * A[i][cb.first];
+            A[i][n] = s;
+        }
+        if (omp_get_thread_num() == 0) {
+            delta.clear();
+            shifted = false;
+        }
+        #pragma omp barrier
+    }
+
+    // Has a float tableau used up its pivots?  The same answer on every
+    // thread, as pivots and flips only change before a barrier.
+    bool OutOfPivots() {
+        if (SINGLE && pivots + flips >= 2 * (m + n))
+            stopped = true;
+        return stopped;
+    }
+
+    // M e_i and M (a_v, c_v) times what they bring to column n: b_i -
+    // Base(v) for the slack v of row i, -Base(v) for x_v, with Sign(v) from
+    // M e_i = Sign(v) M's column for v.
+    double Rhs(int v) const {
+        return Sign(v) * ((v >= n ? b[v - n] : 0) - Base(v));
+    }
+
+    // Recompute row m from cost: d_j = c~_j - c~_B A[.][j], with c~_v =
+    // Sign(v) c_v, and -z in column n.
+    void Costs() {
+        const kernels::Kernels<T> &k = kernels::get<T>();
+        int lo, hi;
+        chunk(0, n + 1, lo, hi);
+        #pragma omp barrier
+        for (int j = lo; j < hi; j++) {
+            int v = j < n ? nonbasic[j] : 0;
+            A[m][j] = j < n && v < n ? Sign(v) * cost[v] : 0;
+        }
+        if (n >= lo && n < hi)
+            for (int v = 0; v < n; v++)
+                A[m][n] -= cost[v] * Base(v);
+        for (int i = 0; i < m; i++)
+            if (basic[i] < n && cost[basic[i]] != 0)
+                k.subMul(A[m] + lo, Sign(basic[i]) * cost[basic[i]],
+                         A[i] + lo, hi - lo);
+        #pragma omp barrier
+    }
+
+    // Move each nonbasic column in cols (the same list on every thread) to
+    // its variable's other bound: x~ goes from 0 to the range, taking
+    // range times the column off column n, and is then counted from there,
+    // which negates the column.  A free variable just changes sign.
+    void Flip(const std::vector<int> &cols) {
+        #pragma omp for
+        for (int i = 0; i <= m; i++) {
+            for (int q : cols) {
+                double range = upper[nonbasic[q]] - lower[nonbasic[q]];
+                if (std::isfinite(range))
+                    A[i][n] -= range * A[i][q];
+                A[i][q] = -A[i][q];
+            }
+        }
+        if (omp_get_thread_num() == 0) {
+            for (int q : cols)
+                atUpper[nonbasic[q]] ^= 1;
+            flips += cols.size();
+        }
+        #pragma omp barrier
+    }
+
+    // Row r's basic variable is to leave at its upper bound.  Count its x~
+    // from there instead, range - x~, which negates row r, so that it
+    // leaves at 0 like any other.
+    void FlipRow(int r) {
+        int lo, hi;
+        chunk(0, n + 1, lo, hi);
+        #pragma omp barrier
+        for (int j = lo; j < hi; j++)
+            A[r][j] = -A[r][j];
+        if (n >= lo && n < hi)
+            A[r][n] += rowUpper[r];
+        if (omp_get_thread_num() == 0)
+            atUpper[basic[r]] ^= 1;
+        #pragma omp barrier
+    }
+
+    // Before pivoting on (r, c): flip row r if its basic variable leaves at
+    // its upper bound.  Every thread decides from A[r][n] before any of them
+    // goes on to Shift or Pivot, which write it.
+    void LeaveRow(int r, int c, double tol) {
+        bool up = harris::leavesAtUpper(A[r][n], A[r][c], rowLower[r],
+                                        rowUpper[r], tol);
+        #pragma omp barrier
+        if (up)
+            FlipRow(r);
+    }
+
+    // A free nonbasic variable may move either way.  Negate its column
+    // where sign * d_j < -EPS, so that increasing it is the way to go, as
+    // for every other column.  d is row m, a pivot row, or Phase1's costs,
+    // which change sign with the column.
+    void Orient(T *d, double sign) {
+        int lo, hi;
+        chunk(0, n, lo, hi);
+        for (int j = lo; j < hi; j++) {
+            int v = nonbasic[j];
+            if (!Free(v) || sign * d[j] >= -EPS)
+                continue;
+            if (d == phase1Cost.data())
+                d[j] = -d[j];
+            for (int i = 0; i <= m; i++)
+                A[i][j] = -A[i][j];
+            atUpper[v] ^= 1;
+        }
+        #pragma omp barrier
+    }
+
+    // Harris lets a blocking row sit just below 0, and pivoting on one with
+    // A[r][c] > 0 would step backwards.  Raise its b_r to 0 first.  Only the
+    // thread that scales A[r][n] in Pivot touches it.
+    void Shift(int r, int c) {
+        int lo, hi;
+        chunk(0, n + 1, lo, hi);
+        if (n >= lo && n < hi && A[r][n] < 0 && A[r][c] > 0) {
+            A[r][n] = 0;
+            shifted = true;
+        }
+    }
+
+    // Pivot, Feasible and Reduce are called by every thread of the team.
+    // inFeasible says which weights the pricing rule needs kept up to date:
+    // dual steepest edge row norms in Feasible(), which picks rows, and
+    // column weights everywhere else.
+    void Pivot(int r, int c, bool inFeasible) {
+        const kernels::Kernels<T> &k = kernels::get<T>();
+        double inv = 1 / A[r][c];
+
+        // Scale our share of the pivot row, except A[r][c]: other threads
+        // may still be reading it for inv.  Row r's tile owner sets it below.
+        int lo, hi;
+        chunk(0, n + 1, lo, hi);
+        if (c >= lo && c < hi) {
+            k.scale(A[r] + lo, inv, c - lo);
+            k.scale(A[r] + c + 1, inv, hi - c - 1);
+        } else {
+            k.scale(A[r] + lo, inv, hi - lo);
+        }
+
+        // Devex: w_j = max(w_j, (a_rj / a_rc)^2 w_c) over our share of the
+        // pivot row; the leaving variable gets max(w_c / a_rc^2, 1).
+        bool devex = rule == pricing::DEVEX && !inFeasible;
+        double wc = devex ? colWeight[c] : 0;
+        if (devex) {
+            for (int j = lo; j < std::min(hi, n); j++) {
+                double w = A[r][j] * A[r][j] * wc;
+                if (j != c && w > colWeight[j])
+                    colWeight[j] = w;
+            }
+        }
+
+        // Steepest edge: every thread sums the squares of the rows it
+        // updates below, while they are still in cache.
+        bool norms = rule == pricing::STEEPEST;
+        double *mine = nullptr;
+        if (norms) {
+            mine = &partial[omp_get_thread_num() * partialStride];
+            std::fill(mine, mine + n, 0.0);
+        }
+
+        // Row tiles, each thread's own first (steal.h).
+        int tileRows = TileRows(m, omp_get_num_threads());
+        int rowTiles = (m + tileRows) / tileRows;
+        tiles.start(rowTiles);
+
+        if (omp_get_thread_num() == 0) {
+            std::swap(basic[r], nonbasic[c]);
+            RowBounds(r);
+        }
+        #pragma omp barrier
+        if (omp_get_thread_num() == 0) {
+            pivots++;
+            // Read by the team only after the barrier that ends Pivot, so
+            // they all stop together.
+            if (cancel && cancel->load(std::memory_order_relaxed))
+                stopped = true;
+            if (devex)
+                colWeight[c] = std::max(wc * inv * inv, 1.0);
+        }
+
+        // The pivot row and column are read in place.  Within each row tile
+        // the column block holding c goes last, so A[i][c] still has its old
+        // value for the other blocks, and is rewritten as that block finishes.
+        const T *pivotRow = A[r];
+        int cBlock = c / PIVOT_TILE_COLS * PIVOT_TILE_COLS;
+        int cEnd = std::min(cBlock + PIVOT_TILE_COLS, n + 1);
+
+        for (int t = tiles.next(); t >= 0; t = tiles.next()) {
+            int i0 = t * tileRows;
+            int i1 = std::min(i0 + tileRows, m + 1);
+            int normRows = std::min(i1, m) - i0; // not the objective row
+            double rowSum[PIVOT_TILE_ROWS] = {};
+            for (int j0 = 0; j0 < n + 1; j0 += PIVOT_TILE_COLS) {
+                if (j0 == cBlock)
+                    continue;
+                int len = std::min(PIVOT_TILE_COLS, n + 1 - j0);
+                for (int i = i0; i < i1; i++) {
+                    if (i == r)
+                        continue;
+                    double f = A[i][c];
+                    if (f != 0)
+                        k.subMul(A[i] + j0, f, pivotRow + j0, len);
+                }
+                if (norms)
+                    for (int i = i0; i < i0 + normRows; i++)
+                        rowSum[i - i0] += pricing::addSquares(
+                            mine + j0, A[i] + j0, std::min(len, n - j0));
+            }
+            for (int i = i0; i < i1; i++) {
+                if (i == r) {
+                    A[r][c] = inv;
+                    continue;
+                }
+                double f = A[i][c];
+                if (f != 0) {
+                    k.subMul(A[i] + cBlock, f, pivotRow + cBlock, c - cBlock);
+                    k.subMul(A[i] + c + 1, f, pivotRow + c + 1, cEnd - c - 1);
+                    A[i][c] = -f * inv;
+                }
+            }
+            if (norms) {
+                int len = std::min(cEnd, n) - cBlock;
+                for (int i = i0; i < i0 + normRows; i++) {
+                    rowSum[i - i0] += pricing::addSquares(
+                        mine + cBlock, A[i] + cBlock, len);
+                    if (inFeasible)
+                        rowWeight[i] = 1.0 + rowSum[i - i0];
+                }
+            }
+        }
+        #pragma omp barrier
+        if (norms && !inFeasible)
+            SumPartials();
+    }
+
+    // Phase 1 for the Harris ratio test, and for any model with bounds:
+    // maximize the sum of the infeasibilities of the basic variables (each
+    // below its lower bound or above its upper one, negated) with the usual
+    // pricing rule, until there are none (true) or no column reduces them
+    // (false).
+    bool Phase1(int &bank, int &segment) {
+        const double tol = useHarris ? FEAS_TOL : EPS;
+        const double pivotTol = useHarris ? PIVOT_TOL : EPS;
+        InitWeights();
+        while (true) {
+            // d_j = the sum of column j over the rows above their upper
+            // bound less that over those below their lower one, for our
+            // share of the columns
+            int lo, hi;
+            chunk(0, n, lo, hi);
+            T *d = phase1Cost.data();
+            std::fill(d + lo, d + hi, 0.0);
+            bool infeasible = false;
+            if (OutOfPivots())
+                return false;
+            for (int i = 0; i < m; i++) {
+                double sign = A[i][n] < rowLower[i] - tol   ? 1.0
+                              : A[i][n] > rowUpper[i] + tol ? -1.0
+                                                            : 0.0;
+                if (sign != 0) {
+                    infeasible = true;
+                    kernels::get<T>().subMul(d + lo, sign, A[i] + lo, hi - lo);
+                }
+            }
+            if (!infeasible)
+                return true;
+            if (anyFree)
+                Orient(d, 1.0);
+            #pragma omp barrier
+
+            int c;
+            double range;
+            Compare min;
+            TopK steps;
+            chunk(0, m, lo, hi);
+            while (true) {
+                Compare max = Price(d, bank, segment);
+                if (max.val < EPS)
+                    return false;
+                c = max.index;
+                range = upper[nonbasic[c]] - lower[nonbasic[c]];
+
+                min = {INF, 0};
+                steps = TopK(RATIO_ROWS, false);
+                min = Reduce(harris::bound(A[0] + n, A[0] + c, A.stride(),
+                                           rowLower.data(), rowUpper.data(),
+                                           lo, hi, pivotTol, tol, min,
+                                           useHarris ? &steps : nullptr),
+                             false, bank);
+                if (min.val != INF || std::isfinite(range))
+                    break;
+                // Only entries below PIVOT_TOL would block: the column's
+                // reduced cost is round-off.  Price again without it.
+                #pragma omp barrier
+                if (omp_get_thread_num() == 0)
+                    d[c] = 0;
+                #pragma omp barrier
+            }
+            if (range <= min.val) {
+                Flip(std::vector<int>(1, c));
+                continue;
+            }
+            if (useHarris)
+                min = Pick(c, lo, hi, pivotTol, tol, min.val, steps, bank);
+
+            int r = min.index;
+            if (boxed)
+                LeaveRow(r, c, tol);
+            if (useHarris)
+                Shift(r, c);
+            Pivot(r, c, false);
+        }
+    }
+
+    // Pivot start's basic columns into the slack basis, each in place of
+    // the slack of one of the rows start leaves nonbasic: the one with the
+    // largest pivot.  A column with no pivot left above PIVOT_TOL (start
+    // was singular, or is for another problem) stays out and a slack stays
+    // in.  Then the nonbasic variables start has at their upper bound are
+    // flipped there.  Returns how many columns went in.
+    int Install(const Basis &start, int &bank) {
+        std::vector<char> leaves(m, 1); // row i's slack is to leave
+        for (int v : start.basic)
+            if (v >= n && v - n < m)
+                leaves[v - n] = 0;
+        int placed = 0;
+        for (int j : start.basic) {
+            // Only slacks leave, so x_j is still in tableau column j.
+            if (j >= n)
+                continue;
+            int lo, hi;
+            chunk(0, m, lo, hi);
+            Compare best = {0.0, 0};
+            for (int r = lo; r < hi; r++) {
+                if (basic[r] >= n && leaves[basic[r] - n] &&
+                    std::fabs(A[r][j]) > best.val) {
+                    best.val = std::fabs(A[r][j]);
+                    best.index = r;
+                }
+            }
+            best = Reduce(best, true, bank);
+            if (best.val < PIVOT_TOL)
+                continue;
+            Pivot(best.index, j, false);
+            placed++;
+        }
+        if (omp_get_thread_num() == 0) {
+            std::vector<char> up(n + m, 0);
+            for (int v : start.upper)
+                if (v >= 0 && v < n + m)
+                    up[v] = 1;
+            flipList.clear();
+            for (int q = 0; q < n; q++) {
+                int v = nonbasic[q];
+                if (up[v] && !atUpper[v] && std::isfinite(upper[v] - lower[v]))
+                    flipList.push_back(q);
+            }
+        }
+        #pragma omp barrier
+        if (!flipList.empty())
+            Flip(flipList);
+        return placed;
+    }
+
+    // Is row m <= 0 (within EPS), so that Dual() can start here?  With
+    // bounds, a free variable needs d_j = 0, and one with a finite range
+    // and d_j > 0 can go to its upper bound instead, which this does.
+    bool DualFeasible(int &bank) {
+        int lo, hi;
+        chunk(0, n, lo, hi);
+        Compare none = {0.0, 0};
+        if (!boxed)
+            return Reduce(kernels::get<T>().argmax(A[m], lo, hi, none), true,
+                          bank)
+                       .val < EPS;
+        Compare worst = none;
+        for (int j = lo; j < hi; j++) {
+            int v = nonbasic[j];
+            double d = Free(v) ? std::fabs(A[m][j]) : A[m][j];
+            if (std::isfinite(upper[v] - lower[v]) || d <= worst.val)
+                continue;
+            worst.val = d;
+            worst.index = j;
+        }
+        if (Reduce(worst, true, bank).val >= EPS)
+            return false;
+        if (omp_get_thread_num() == 0) {
+            flipList.clear();
+            for (int j = 0; j < n; j++)
+                if (A[m][j] >= EPS)
+                    flipList.push_back(j);
+        }
+        #pragma omp barrier
+        if (!flipList.empty())
+            Flip(flipList);
+        return true;
+    }
+
+    // Dual simplex: row m stays <= 0 while the negative b_r are pivoted out,
+    // the most negative first (by dual steepest edge under that rule).  The
+    // entering column is the one whose reduced cost reaches 0 first, as a
+    // Harris two-pass test on row m.  True once b >= 0, false if a negative
+    // row has no negative entry to pivot on: the LP is infeasible.  With
+    // bounds, a row above its upper bound is flipped to count from it, and
+    // so goes negative, and free columns are turned to have a negative
+    // entry in the pivot row.
+    //
+    // With many d_j == 0 the dual steps are all zero and it can cycle, so
+    // under Harris row m is first pushed down a little, as b is pushed up
+    // for primal simplex, and Costs() recomputes it at the end.
+    bool Dual(int &bank) {
+        bool dse = rule == pricing::STEEPEST;
+        if (dse) {
+            #pragma omp for
+            for (int i = 0; i < m; i++)
+                rowWeight[i] = 1.0 + pricing::sumSquares(A[i], n);
+        }
+        if (useHarris) {
+            int lo, hi;
+            chunk(0, n, lo, hi);
+            std::vector<double> d = harris::perturbation(A[m], 1, n);
+            for (int j = lo; j < hi; j++)
+                A[m][j] -= d[j];
+            #pragma omp barrier
+        }
+        bool feasible = DualPivots(bank);
+        if (useHarris)
+            Costs();
+        return feasible;
+    }
+
+    bool DualPivots(int &bank) {
+        const kernels::Kernels<T> &k = kernels::get<T>();
+        double feasTol = useHarris ? FEAS_TOL : EPS;
+        double pivotTol = useHarris ? PIVOT_TOL : EPS;
+        bool dse = rule == pricing::STEEPEST;
+        while (!OutOfPivots()) {
+            int r, lo, hi;
+            Compare none = {0.0, 0};
+            chunk(0, m, lo, hi);
+            if (boxed) {
+                Compare best = Reduce(
+                    pricing::argmaxViolation(A[0] + n, A.stride(),
+                                             rowLower.data(), rowUpper.data(),
+                                             dse ? rowWeight.data() : nullptr,
+                                             lo, hi, feasTol, none),
+                    true, bank);
+                if (best.val == 0)
+                    return true;
+                r = best.index;
+                if (A[r][n] > rowUpper[r])
+                    FlipRow(r);
+                if (anyFree)
+                    Orient(A[r], -1.0);
+            } else if (dse) {
+                Compare best = Reduce(
+                    pricing::argmaxInfeasible(A[0] + n, A.stride(),
+                                              rowWeight.data(), lo, hi,
+                                              feasTol, none),
+                    true, bank);
+                if (best.val == 0)
+                    return true;
+                r = best.index;
+            } else {
+                Compare min = {INF, 0};
+                min = Reduce(k.argmin(A[0] + n, A.stride(), lo, hi, min),
+                             false, bank);
+                if (min.val > -feasTol)
+                    return true;
+                r = min.index;
+            }
+
+            chunk(0, n, lo, hi);
+            Compare step = {INF, 0};
+            step = Reduce(harris::dualBound(A[m], A[r], lo, hi, pivotTol, EPS,
+                                            step),
+                          false, bank);
+            if (step.val == INF)
+                return false;
+            step = Reduce(harris::dualPick(A[m], A[r], lo, hi, pivotTol,
+                                           step.val, none),
+                          true, bank);
+            Pivot(r, step.index, true);
+        }
+        return false;
+    }
+
+    // The original phase 1, kept for SIMPLEX_RATIO=textbook: pivot on the
+    // most negative b_r (or by dual steepest edge), its most negative entry,
+    // and the rows below r that block first.
+    bool Feasible(int &bank) {
+        const kernels::Kernels<T> &k = kernels::get<T>();
+        int r = 0, c = 0;
+        int lo, hi;
+        bool dse = rule == pricing::STEEPEST;
+        if (dse) {
+            #pragma omp for
+            for (int i = 0; i < m; i++)
+                rowWeight[i] = 1.0 + pricing::sumSquares(A[i], n);
+        }
+        while (!OutOfPivots()) {
+            double p = INF;
+            
+            struct Compare min;
+            min.val = p;
+            min.index = r;
+            chunk(0, m, lo, hi);
+            if (dse) {
+                // Dual steepest edge: largest b_i^2 / |row i|^2
+                Compare none = {0.0, 0};
+                min = Reduce(pricing::argmaxInfeasible(A[0] + n, A.stride(),
+                                                       rowWeight.data(), lo,
+                                                       hi, EPS, none),
+                             true, bank);
+                if (min.val == 0)
+                    return true;
+                r = min.index;
+            } else {
+                min = Reduce(k.argmin(A[0] + n, A.stride(), lo, hi, min),
+                             false, bank);
+                p = min.val; 
+                r = min.index;
+
+                if (p > -EPS)
+                    return true;
+            }
+            
+            p = 0.0;
+            min.val = p;
+            min.index = c;
+            chunk(0, n, lo, hi);
+            min = Reduce(k.argmin(A[r], 1, lo, hi, min), false, bank);
+            p = min.val; 
+            c = min.index;
+
+            if (p > -EPS)
+                return false;
+            
+            p = A[r][n] / A[r][c];
+            
+            min.val = p;
+            min.index = r;
+            chunk(r + 1, m, lo, hi);
+            min = Reduce(k.minRatio(A[0] + n, A[0] + c, A.stride(), lo, hi,
+                                    EPS, min),
+                         false, bank);
+            p = min.val; 
+            r = min.index;
+
+            Pivot(r, c, true);
+        }
+        return false;
+    }
+};
+
+// std::min takes them by reference, so they need a definition.
+template <class T> constexpr int Simplex<T>::PIVOT_TILE_ROWS;
+template <class T> constexpr int Simplex<T>::PIVOT_TILE_COLS;
+template <class T> constexpr int Simplex<T>::STEAL_TILES;
+template <class T> constexpr int Simplex<T>::PARTIAL_SEGMENTS;
+template <class T> constexpr int Simplex<T>::PARTIAL_MIN;
+
+#endif
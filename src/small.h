@@ -0,0 +1,226 @@
+// A Simplex for small LPs, sized at compile time: SmallSimplex<M, N> solves
+//     max c dot x s.t. a x <= b  x >= 0
+// for up to M constraints and N variables with the tableau on the stack and
+// every loop running over the padded M and N, so the compiler unrolls and
+// vectorizes them with no threads, no heap and no dispatch.  On problems
+// the size of afiro the OpenMP engine's team start-up and barriers cost
+// more than the pivots.
+//
+// Padding is harmless: an extra column is a variable with zero cost and
+// coefficients, which never enters, and an extra row is 0 <= 0.
+//
+// Phase 1 is the textbook one with an auxiliary variable x0 (max -x0 s.t.
+// a x - x0 <= b): one pivot on the most negative b_i makes the basis
+// feasible.  Pricing is Dantzig's, switching to Bland's rule after a run of
+// degenerate pivots, so it can't cycle.
+//
+// solveSmall() picks the smallest instance that fits, or returns false if
+// the problem is larger than SMALL_MAX either way.
+
+#ifndef SMALL_H
+#define SMALL_H
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+const int SMALL_MAX = 64;
+
+template <int M, int N> class SmallSimplex {
+  private:
+    // Columns: x_0 .. x_{N-1}, the auxiliary x0, then b.  Rows: the
+    // constraints, then the objective, then phase 1's objective.
+    static const int X0 = N, RHS = N + 1, W = N + 2;
+    static const int OBJ = M, AUX = M + 1;
+    // Degenerate pivots in a row before Bland's rule takes over.
+    static const int STALL = 8;
+
+    double A[M + 2][W];
+    int basic[M];        // variables: x_j as j, x0 as N, slack i as W + i
+    int nonbasic[N + 1]; // by column
+    int stall;
+
+  public:
+    double soln[N];
+    double z;
+    int lp_type;
+    int pivots;
+
+    const double EPS = 1e-9;
+    const static int FEASIBLE = 1;
+    const static int INFEASIBLE = 0;
+    const static int UNBOUNDED = -1;
+
+    /*
+      input:
+        m <= M constraints, n <= N variables, a[i][j] for i < m, j < n
+        max c dot x s.t. a x <= b  x >= 0
+      output:
+        lp_type, and when FEASIBLE z and soln[0 .. n), as for Simplex.
+    */
+    template <class Rows>
+    SmallSimplex(int m, int n, const Rows &a, const double *b,
+                 const double *c)
+        : stall(0), z(0), lp_type(INFEASIBLE), pivots(0) {
+        for (int i = 0; i < M + 2; i++)
+            for (int j = 0; j < W; j++)
+                A[i][j] = 0;
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < n; j++)
+                A[i][j] = a[i][j];
+            A[i][RHS] = b[i];
+        }
+        for (int j = 0; j < n; j++)
+            A[OBJ][j] = c[j];
+        for (int i = 0; i < M; i++)
+            basic[i] = W + i;
+        for (int j = 0; j <= N; j++)
+            nonbasic[j] = j;
+
+        if (!Phase1())
+            return;
+        if (!Optimize(OBJ))
+            return;
+        for (int j = 0; j < N; j++)
+            soln[j] = 0;
+        for (int i = 0; i < M; i++)
+            if (basic[i] < N)
+                soln[basic[i]] = A[i][RHS];
+        z = -A[OBJ][RHS];
+        lp_type = FEASIBLE;
+    }
+
+  private:
+    // Feasible start, x0 left out of the problem: false if infeasible.
+    bool Phase1() {
+        int r = 0;
+        for (int i = 1; i < M; i++)
+            if (A[i][RHS] < A[r][RHS])
+                r = i;
+        if (A[r][RHS] > -EPS)
+            return true;
+        for (int i = 0; i < M; i++)
+            A[i][X0] = -1;
+        A[AUX][X0] = -1;
+        Pivot(r, X0);
+        Optimize(AUX);
+        if (A[AUX][RHS] > EPS)
+            return false;
+        // x0 is 0; if still basic, swap it for any column its row has.
+        for (int i = 0; i < M; i++) {
+            if (basic[i] != X0)
+                continue;
+            int q = -1;
+            for (int j = 0; j < N + 1; j++)
+                if (nonbasic[j] != X0 && std::fabs(A[i][j]) > EPS &&
+                    (q < 0 || std::fabs(A[i][j]) > std::fabs(A[i][q])))
+                    q = j;
+            if (q >= 0)
+                Pivot(i, q);
+        }
+        // Fix x0 at 0: a nonbasic x0's column goes.
+        for (int j = 0; j < N + 1; j++)
+            if (nonbasic[j] == X0)
+                for (int i = 0; i < M + 2; i++)
+                    A[i][j] = 0;
+        return true;
+    }
+
+    // Primal simplex on objective row obj: false if unbounded.
+    bool Optimize(int obj) {
+        while (true) {
+            bool bland = stall >= STALL;
+            int c = -1;
+            for (int j = 0; j < N + 1; j++) {
+                if (A[obj][j] <= EPS)
+                    continue;
+                if (c < 0 || (bland ? nonbasic[j] < nonbasic[c]
+                                    : A[obj][j] > A[obj][c]))
+                    c = j;
+            }
+            if (c < 0)
+                return true;
+
+            int r = -1;
+            double best = INFINITY;
+            for (int i = 0; i < M; i++) {
+                if (A[i][c] <= EPS)
+                    continue;
+                double v = A[i][RHS] / A[i][c];
+                bool tie = r >= 0 && v == best;
+                if (v < best ||
+                    (tie && (bland ? basic[i] < basic[r]
+                                   : A[i][c] > A[r][c]))) {
+                    best = v;
+                    r = i;
+                }
+            }
+            if (r < 0) {
+                lp_type = UNBOUNDED;
+                return false;
+            }
+            stall = best > EPS ? 0 : stall + 1;
+            Pivot(r, c);
+        }
+    }
+
+    void Pivot(int r, int c) {
+        std::swap(basic[r], nonbasic[c]);
+        pivots++;
+        double inv = 1 / A[r][c];
+        // A copy of the pivot row, which the compiler can see no other row
+        // aliases, so the update loop vectorizes.
+        double p[W];
+        for (int j = 0; j < W; j++)
+            p[j] = A[r][j] *= inv;
+        A[r][c] = inv;
+        for (int i = 0; i < M + 2; i++) {
+            double f = A[i][c];
+            if (i == r || f == 0)
+                continue;
+            for (int j = 0; j < W; j++)
+                A[i][j] -= f * p[j];
+            A[i][c] = -f * inv;
+        }
+    }
+};
+
+// What solveSmall() found.
+struct SmallResult {
+    int lp_type = 0; // INFEASIBLE
+    double z = 0;
+    std::vector<double> soln; // size n
+    int pivots = 0;
+};
+
+template <int S, class Rows>
+inline void solveSmallAs(int m, int n, const Rows &a, const double *b,
+                         const double *c, SmallResult &out) {
+    SmallSimplex<S, S> lp(m, n, a, b, c);
+    out.lp_type = lp.lp_type;
+    out.z = lp.z;
+    out.soln.assign(lp.soln, lp.soln + n);
+    out.pivots = lp.pivots;
+}
+
+// Solve an m x n problem with the smallest SmallSimplex that holds it.
+// False, leaving out alone, if m or n is above SMALL_MAX.
+template <class Rows>
+inline bool solveSmall(int m, int n, const Rows &a, const double *b,
+                       const double *c, SmallResult &out) {
+    int size = std::max(m, n);
+    if (size <= 8)
+        solveSmallAs<8>(m, n, a, b, c, out);
+    else if (size <= 16)
+        solveSmallAs<16>(m, n, a, b, c, out);
+    else if (size <= 32)
+        solveSmallAs<32>(m, n, a, b, c, out);
+    else if (size <= SMALL_MAX)
+        solveSmallAs<SMALL_MAX>(m, n, a, b, c, out);
+    else
+        return false;
+    return true;
+}
+
+#endif
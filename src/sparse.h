@@ -0,0 +1,157 @@
+// Sparse storage for the constraint matrix, kept both column-wise (CSC) and
+// row-wise (CSR).  Netlib models are over 99% zeros, so this is what the MPS
+// loader fills and what the revised simplex engine works from; only the
+// dense tableau engine expands it (see scatterRow).
+//
+// The kernels take dense vectors: dot and axpy against one column or row,
+// and products with A and A^T.
+
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include <algorithm>
+#include <vector>
+
+struct Triplet {
+    int row, col;
+    double value;
+};
+
+struct SparseMatrix {
+    int m = 0, n = 0;
+
+    // Column j's entries are rowIndex/colValue[colStart[j] .. colStart[j+1]).
+    std::vector<int> colStart, rowIndex;
+    std::vector<double> colValue;
+
+    // Row i's entries are colIndex/rowValue[rowStart[i] .. rowStart[i+1]).
+    std::vector<int> rowStart, colIndex;
+    std::vector<double> rowValue;
+
+    int nnz() const { return (int)rowIndex.size(); }
+
+    // m x n from (row, col, value) entries in any order.  Duplicates are
+    // summed and entries that come to zero are dropped.
+    static SparseMatrix fromTriplets(int m, int n, std::vector<Triplet> t) {
+        std::sort(t.begin(), t.end(), [](const Triplet &a, const Triplet &b) {
+            return a.col != b.col ? a.col < b.col : a.row < b.row;
+        });
+        SparseMatrix S;
+        S.m = m;
+        S.n = n;
+        S.colStart.assign(n + 1, 0);
+        for (size_t k = 0; k < t.size();) {
+            int i = t[k].row, j = t[k].col;
+            double v = 0;
+            for (; k < t.size() && t[k].row == i && t[k].col == j; k++)
+                v += t[k].value;
+            if (v == 0)
+                continue;
+            S.rowIndex.push_back(i);
+            S.colValue.push_back(v);
+            S.colStart[j + 1]++;
+        }
+        for (int j = 0; j < n; j++)
+            S.colStart[j + 1] += S.colStart[j];
+        S.buildRows();
+        return S;
+    }
+
+    // Keep the nonzeros of a dense m x n matrix (rows may be longer than n).
+    template <class Rows>
+    static SparseMatrix fromDense(int m, int n, const Rows &A) {
+        SparseMatrix S;
+        S.m = m;
+        S.n = n;
+        S.colStart.assign(n + 1, 0);
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++)
+                if (A[i][j] != 0)
+                    S.colStart[j + 1]++;
+        for (int j = 0; j < n; j++)
+            S.colStart[j + 1] += S.colStart[j];
+        S.rowIndex.resize(S.colStart[n]);
+        S.colValue.resize(S.colStart[n]);
+        std::vector<int> next(S.colStart.begin(), S.colStart.end() - 1);
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < n; j++) {
+                if (A[i][j] != 0) {
+                    S.rowIndex[next[j]] = i;
+                    S.colValue[next[j]++] = A[i][j];
+                }
+            }
+        }
+        S.buildRows();
+        return S;
+    }
+
+    // Derive the row view from the column view.
+    void buildRows() {
+        rowStart.assign(m + 1, 0);
+        for (int i : rowIndex)
+            rowStart[i + 1]++;
+        for (int i = 0; i < m; i++)
+            rowStart[i + 1] += rowStart[i];
+        colIndex.resize(nnz());
+        rowValue.resize(nnz());
+        std::vector<int> next(rowStart.begin(), rowStart.end() - 1);
+        for (int j = 0; j < n; j++) {
+            for (int e = colStart[j]; e < colStart[j + 1]; e++) {
+                int k = next[rowIndex[e]]++;
+                colIndex[k] = j;
+                rowValue[k] = colValue[e];
+            }
+        }
+    }
+
+    // Write row i into the dense array x[0 .. n), zeros included.
+    template <class T> void scatterRow(int i, T *x) const {
+        std::fill(x, x + n, (T)0);
+        for (int e = rowStart[i]; e < rowStart[i + 1]; e++)
+            x[colIndex[e]] = rowValue[e];
+    }
+
+    // column j dot y, y dense of size m
+    double dotColumn(int j, const double *y) const {
+        double s = 0;
+        for (int e = colStart[j]; e < colStart[j + 1]; e++)
+            s += colValue[e] * y[rowIndex[e]];
+        return s;
+    }
+
+    // row i dot x, x dense of size n
+    double dotRow(int i, const double *x) const {
+        double s = 0;
+        for (int e = rowStart[i]; e < rowStart[i + 1]; e++)
+            s += rowValue[e] * x[colIndex[e]];
+        return s;
+    }
+
+    // y += a * column j
+    void axpyColumn(int j, double a, double *y) const {
+        for (int e = colStart[j]; e < colStart[j + 1]; e++)
+            y[rowIndex[e]] += a * colValue[e];
+    }
+
+    // x += a * row i
+    void axpyRow(int i, double a, double *x) const {
+        for (int e = rowStart[i]; e < rowStart[i + 1]; e++)
+            x[colIndex[e]] += a * rowValue[e];
+    }
+
+    // y = A x
+    void multiply(const double *x, double *y) const {
+        for (int i = 0; i < m; i++)
+            y[i] = dotRow(i, x);
+    }
+
+    // x = A^T y.  Row-wise, so rows with y_i == 0 cost nothing.
+    void multiplyTranspose(const double *y, double *x) const {
+        std::fill(x, x + n, 0.0);
+        for (int i = 0; i < m; i++)
+            if (y[i] != 0)
+                axpyRow(i, y[i], x);
+    }
+};
+
+#endif
@@ -0,0 +1,90 @@
+// Work stealing over tiles [0, count) for an OpenMP team, for Pivot's row
+// tiles.  Each thread owns a contiguous share of the tiles, the same share
+// for the same count and team size, and takes its own from the front.  Once
+// they run out it steals from the back of the others' shares, nearest
+// thread first, so a thread that skips most of its rows (A[i][c] == 0)
+// helps one that doesn't instead of waiting at the barrier.  Owners work
+// towards thieves from opposite ends, so rows stay with the thread that
+// owns them (and in its cache, and on its node) unless it falls behind.
+//
+// Each share is one 64-bit word, front and back, claimed by compare and
+// swap: no locks, and a tile is taken exactly once.
+//
+// SIMPLEX_SCHEDULE=static turns stealing off: each thread does its own
+// share, as a static omp for would.
+
+#ifndef STEAL_H
+#define STEAL_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <omp.h>
+
+class TileQueue {
+  public:
+    static bool stealingEnabled() {
+        const char *env = getenv("SIMPLEX_SCHEDULE");
+        return !(env && strcmp(env, "static") == 0);
+    }
+
+    // Room for teams of up to threads.
+    explicit TileQueue(int threads = 0)
+        : shares(threads), steal(stealingEnabled()) {}
+
+    // The first tile of thread t's share of count tiles among nt threads:
+    // the share is [first(count, nt, t), first(count, nt, t + 1)).
+    static int first(int count, int nt, int t) {
+        return (int)((long)count * t / nt);
+    }
+
+    // Called by every thread of the team, followed by a barrier before
+    // anyone calls next().
+    void start(int count) {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        shares[t].range.store(pack(first(count, nt, t),
+                                   first(count, nt, t + 1)));
+    }
+
+    // The next tile for this thread, or -1 once there are none left
+    // anywhere.  Follow the last call with a barrier before the next
+    // start().
+    int next() {
+        int t = omp_get_thread_num(), nt = omp_get_num_threads();
+        int k = take(t, true);
+        for (int d = 1; k < 0 && steal && d < nt; d++)
+            k = take((t + d) % nt, false);
+        return k;
+    }
+
+  private:
+    struct Share {
+        std::atomic<uint64_t> range; // front in the low half, back high
+        char pad[64 - sizeof(std::atomic<uint64_t>)];
+    };
+    std::vector<Share> shares;
+    bool steal;
+
+    static uint64_t pack(uint32_t front, uint32_t back) {
+        return (uint64_t)back << 32 | front;
+    }
+
+    // A tile from the front or back of thread t's share, or -1 if empty.
+    int take(int t, bool front) {
+        std::atomic<uint64_t> &range = shares[t].range;
+        uint64_t r = range.load();
+        while (true) {
+            uint32_t f = (uint32_t)r, b = (uint32_t)(r >> 32);
+            if (f >= b)
+                return -1;
+            uint64_t left = front ? pack(f + 1, b) : pack(f, b - 1);
+            if (range.compare_exchange_weak(r, left))
+                return front ? f : b - 1;
+        }
+    }
+};
+
+#endif
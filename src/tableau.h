@@ -0,0 +1,131 @@
+// Dense simplex tableau stored as one contiguous, 64-byte aligned, row-major
+// block.  Rows are padded so every row starts on a cache line, which keeps the
+// rank-1 update in Pivot streaming through memory without a pointer chase
+// per row (as std::vector<std::vector<double>> needed).
+//
+// The element type is a parameter so the solver can run on a float tableau
+// at half the memory traffic; Tableau is the double one.
+
+#ifndef TABLEAU_H
+#define TABLEAU_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+template <class T> class BasicTableau {
+  public:
+    static const int ALIGN = 64;                    // bytes
+    static const int ROW_ALIGN = ALIGN / sizeof(T); // elements
+
+    BasicTableau()
+        : rows_(0), cols_(0), stride_(0), capacity_(0), data_(nullptr) {}
+
+    // rows x cols, zero filled, or if not zero, left untouched for the
+    // caller to fill: the first thread to touch a page decides its NUMA
+    // node (numa.h).
+    BasicTableau(int rows, int cols, bool zero = true)
+        : rows_(rows), cols_(cols), stride_(paddedStride(cols)),
+          capacity_(rows), data_(allocate(rows, stride_, zero)) {}
+
+    BasicTableau(const BasicTableau &) = delete;
+    BasicTableau &operator=(const BasicTableau &) = delete;
+
+    BasicTableau(BasicTableau &&o) : BasicTableau() { swap(o); }
+    BasicTableau &operator=(BasicTableau &&o) {
+        swap(o);
+        return *this;
+    }
+
+    ~BasicTableau() { free(data_); }
+
+    void swap(BasicTableau &o) {
+        std::swap(rows_, o.rows_);
+        std::swap(cols_, o.cols_);
+        std::swap(stride_, o.stride_);
+        std::swap(capacity_, o.capacity_);
+        std::swap(data_, o.data_);
+    }
+
+    // Change the number of rows, keeping the existing ones; new rows are
+    // zero.  Capacity doubles, so adding rows one at a time (cuts) copies
+    // the block only O(log rows) times.
+    void resizeRows(int rows) {
+        if (rows > capacity_) {
+            int capacity = std::max(rows, 2 * capacity_);
+            T *data = allocate(capacity, stride_);
+            if (data_)
+                memcpy(data, data_, (size_t)rows_ * stride_ * sizeof(T));
+            free(data_);
+            data_ = data;
+            capacity_ = capacity;
+        } else if (rows > rows_) {
+            memset((*this)[rows_], 0,
+                   (size_t)(rows - rows_) * stride_ * sizeof(T));
+        }
+        rows_ = rows;
+    }
+
+    T *operator[](int i) { return data_ + (size_t)i * stride_; }
+    const T *operator[](int i) const {
+        return data_ + (size_t)i * stride_;
+    }
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    // Distance between consecutive rows, in elements.
+    int stride() const { return stride_; }
+    T *data() { return data_; }
+
+    // Change the number of columns, keeping the existing ones.  Columns
+    // past the old count hold whatever was there (zero, or a removed
+    // column), so the caller fills them.  A wider stride grows by at least
+    // an eighth, so adding columns one at a time rarely moves the block.
+    void resizeCols(int cols) {
+        if (cols > stride_) {
+            int stride = paddedStride(std::max(cols, stride_ + stride_ / 8));
+            T *data = allocate(capacity_, stride);
+            for (int i = 0; i < rows_; i++)
+                memcpy(data + (size_t)i * stride, (*this)[i],
+                       cols_ * sizeof(T));
+            free(data_);
+            data_ = data;
+            stride_ = stride;
+        }
+        cols_ = cols;
+    }
+
+  private:
+    int rows_, cols_, stride_;
+    int capacity_; // rows allocated
+    T *data_;
+
+    // rows x stride elements, zero filled if zero, or null if that is 0.
+    static T *allocate(int rows, int stride, bool zero = true) {
+        size_t bytes = (size_t)rows * stride * sizeof(T);
+        if (bytes == 0)
+            return nullptr;
+        void *p;
+        if (posix_memalign(&p, ALIGN, bytes))
+            throw std::bad_alloc();
+        if (zero)
+            memset(p, 0, bytes);
+        return (T *)p;
+    }
+
+    // Round up to whole cache lines, and step off strides that are a
+    // multiple of 4KB so consecutive rows don't share cache sets.
+    static int paddedStride(int cols) {
+        int s = (cols + ROW_ALIGN - 1) / ROW_ALIGN * ROW_ALIGN;
+        if (s > 0 && (s * sizeof(T)) % 4096 == 0)
+            s += ROW_ALIGN;
+        return s;
+    }
+};
+
+typedef BasicTableau<double> Tableau;
+
+#endif
@@ -0,0 +1,85 @@
+// Top-k selection for the tableau Simplex's scans.  Reduce (Simplex)
+// combines one Compare per thread into the single best; TopK keeps the k
+// best (val, index) pairs instead, so one pass over the data yields a
+// shortlist: the columns multiple pricing picks from (pricing.h), or the
+// rows the Harris ratio test's second pass chooses among (harris.h).
+//
+// Each thread offers its share of the data to its own TopK, a bounded heap
+// with the worst pair kept at the root, so most values are turned away
+// with one comparison.  Simplex::ReduceTop then merges the threads' heaps
+// the way Reduce merges their Compares: published in per-thread slots,
+// one barrier, and every thread folding all of them in the same order.
+// No locks and no atomics.
+//
+// Order is by val, larger or smaller first, ties to the smaller index, as
+// in Reduce, so the k best are the same set however many threads found
+// them.
+
+#ifndef TOPK_H
+#define TOPK_H
+
+#include <algorithm>
+
+#include "kernels.h"
+
+// Most pairs a TopK holds.
+const int TOPK_MAX = 16;
+
+class TopK {
+  public:
+    // The k (up to TOPK_MAX) largest vals if maximize, else the smallest.
+    explicit TopK(int k = 1, bool maximize = true)
+        : count(0), k(std::min(std::max(k, 1), TOPK_MAX)),
+          maximize(maximize) {}
+
+    // Keep (val, index) if it is among the k best so far.
+    void offer(double val, int index) {
+        Compare c = {val, index};
+        if (count < k) {
+            heap[count++] = c;
+            std::push_heap(heap, heap + count, Ahead(maximize));
+        } else if (Ahead(maximize)(c, heap[0])) {
+            std::pop_heap(heap, heap + count, Ahead(maximize));
+            heap[count - 1] = c;
+            std::push_heap(heap, heap + count, Ahead(maximize));
+        }
+    }
+
+    // Offer every pair other holds.
+    void merge(const TopK &other) {
+        for (int i = 0; i < other.count; i++)
+            offer(other.heap[i].val, other.heap[i].index);
+    }
+
+    // Best first.  Ends the heap: offer nothing more afterwards.
+    void sort() { std::sort_heap(heap, heap + count, Ahead(maximize)); }
+
+    // Does it hold k pairs, so that something offered may have been
+    // turned away?
+    bool full() const { return count == k; }
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    const Compare *begin() const { return heap; }
+    const Compare *end() const { return heap + count; }
+    const Compare &operator[](int i) const { return heap[i]; }
+
+  private:
+    Compare heap[TOPK_MAX];
+    int count, k;
+    bool maximize;
+
+    // Is a better than b?  As the heap's order, that keeps the worst at
+    // the root.
+    struct Ahead {
+        bool maximize;
+        explicit Ahead(bool maximize) : maximize(maximize) {}
+        bool operator()(const Compare &a, const Compare &b) const {
+            if (a.val == b.val)
+                return a.index < b.index;
+            return maximize ? a.val > b.val : a.val < b.val;
+        }
+    };
+};
+
+#endif